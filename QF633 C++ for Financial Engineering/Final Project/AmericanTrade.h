@@ -10,8 +10,9 @@
 class AmericanOption : public TreeProduct {
 public:
 	AmericanOption(const string& _trade_id, double _notional, OptionType _optType, double _strike, const Date& _expiry, const string& _underlying)
-		: TreeProduct(_trade_id, "AM_" + to_string(_strike) + "_" + to_string(_optType) + "_" + _underlying + "_" + to_string(_expiry.year) + "-" + to_string(_expiry.month) + "-" + to_string(_expiry.day)),
-		notional(_notional), optType(_optType), strike(_strike), expiryDate(_expiry), underlying(_underlying) {
+		: TreeProduct(_trade_id, "AM_" + to_string(_strike) + "_" + to_string(_optType) + "_" + _underlying + "_" + to_string(_expiry.getYear()) + "-" + to_string(_expiry.getMonth()) + "-" + to_string(_expiry.getDay())),
+		notional(_notional), optType(_optType), strike(_strike), expiryDate(_expiry) {
+		underlying = _underlying;
 	}
 
 	// for trade factory
@@ -50,9 +51,9 @@ public:
 			to_string(strike) + "_" +
 			to_string(optType) + "_" +
 			underlying + "_" +
-			to_string(expiryDate.year) + "-" +
-			to_string(expiryDate.month) + "-" +
-			to_string(expiryDate.day);
+			to_string(expiryDate.getYear()) + "-" +
+			to_string(expiryDate.getMonth()) + "-" +
+			to_string(expiryDate.getDay());
 	}
 	inline void updateTreeProductTradeName() {
 		updateName(tradeName);
@@ -65,6 +66,13 @@ public:
 	inline string getCurvename() const override { return curvename; }
 	inline string getVolname() const override { return volname; }
 	inline string getDirection() const override { return direction; }
+	inline double getStrike() const { return strike; }
+	inline OptionType getOptionType() const { return optType; }
+	inline void hashTerms(HASH::Hasher& h) const override {
+		TreeProduct::hashTerms(h);
+		h.add(strike);
+		h.add(int(optType));
+	}
 
 	// pricing
 	virtual double Payoff(double S) const 
@@ -75,16 +83,19 @@ public:
 	{
 		return std::max(Payoff(S), continuation);
 	}
+	bool latticePrice(LATTICE::Model model, const TreeInputs& in, int nSteps, double* states, double* spots, double& value, LATTICE::Greeks* greeks) const override
+	{
+		value = LATTICE::priceVanilla<LATTICE::American>(model, optType, strike, in, nSteps, states, spots, greeks);
+		return true;
+	}
 
 private:
-	string trade_id;
 	string tradeName;
 	OptionType optType;
 	double strike;
 	string curvename;
 	string volname;
 	Date expiryDate;
-	string underlying;
 	double notional;
 	string direction;
 };
@@ -92,10 +103,11 @@ private:
 class AmerCallSpread : public TreeProduct {
 public:
 	AmerCallSpread(const string& _trade_id, double _notional, double _k1, double _k2, const Date& _expiry, const string& _underlying)
-		: TreeProduct(_trade_id, "AM_Call_Spread_" + to_string(_k1) + "_" + to_string(_k2) + "_" + _underlying + "_" + to_string(_expiry.year) + "-" + to_string(_expiry.month) + "-" + to_string(_expiry.day)),
-		notional(_notional), strike1(_k1), strike2(_k2), expiryDate(_expiry), underlying(_underlying)
+		: TreeProduct(_trade_id, "AM_Call_Spread_" + to_string(_k1) + "_" + to_string(_k2) + "_" + _underlying + "_" + to_string(_expiry.getYear()) + "-" + to_string(_expiry.getMonth()) + "-" + to_string(_expiry.getDay())),
+		notional(_notional), strike1(_k1), strike2(_k2), expiryDate(_expiry)
 	{
 		assert(_k1 < _k2);
+		underlying = _underlying;
 	};
 	inline void setdirection(const string& _direction) {
 		direction = _direction;
@@ -118,19 +130,27 @@ public:
 	{
 		return std::max(Payoff(S), continuation);
 	}
+	bool latticePrice(LATTICE::Model model, const TreeInputs& in, int nSteps, double* states, double* spots, double& value, LATTICE::Greeks* greeks) const override
+	{
+		value = LATTICE::price<LATTICE::CallSpread, LATTICE::American>(model, in, nSteps, LATTICE::CallSpread{ strike1, strike2 }, states, spots, greeks);
+		return true;
+	}
 
 	inline string getUnderlying() const override { return underlying; }
 	inline double getNotional() const override { return notional; }
 	inline string getCurvename() const { return curvename; }
 	inline string getVolname() const override { return volname; }
 	inline string getDirection() const override { return direction; }
+	inline void hashTerms(HASH::Hasher& h) const override {
+		TreeProduct::hashTerms(h);
+		h.add(strike1);
+		h.add(strike2);
+	}
 
 private:
-	string trade_id;
 	double strike1;
 	double strike2;
 	Date expiryDate;
-	string underlying;
 	double notional;
 	string curvename;
 	string volname;
@@ -0,0 +1,327 @@
+#include <cstdio>
+#include <cstring>
+#include <charconv>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "BinaryTradeFile.h"
+#include "Types.h"
+
+using namespace TRADEFILE;
+
+namespace
+{
+	uint8_t toDirection(const TradeRecord& rec)
+	{
+		if (rec.direction == "pay")
+			return Pay;
+		if (rec.direction == "receive")
+			return Receive;
+		if (rec.direction == "long")
+			return Long;
+		if (rec.direction == "short")
+			return Short;
+		throw std::runtime_error("Error: unknown direction for trade " + string(rec.id));
+	}
+
+	string_view directionName(uint8_t direction)
+	{
+		switch (direction)
+		{
+		case Pay:
+			return "pay";
+		case Receive:
+			return "receive";
+		case Long:
+			return "long";
+		case Short:
+			return "short";
+		default:
+			throw std::runtime_error("Error: corrupt direction in trade file");
+		}
+	}
+
+	uint8_t toOptionType(const TradeRecord& rec)
+	{
+		if (rec.option == "call")
+			return Call;
+		if (rec.option == "put")
+			return Put;
+		throw std::runtime_error("Error: unknown option type for trade " + string(rec.id));
+	}
+
+	string_view optionName(uint8_t optType)
+	{
+		switch (optType)
+		{
+		case Call:
+			return "call";
+		case Put:
+			return "put";
+		default:
+			throw std::runtime_error("Error: corrupt option type in trade file");
+		}
+	}
+
+	// shortest round trip text, never in exponent form
+	void writeNumber(ostream& os, double value)
+	{
+		char buf[64];
+		auto res = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed);
+		os.write(buf, res.ptr - buf);
+	}
+
+	void writeDate(ostream& os, const Date& date)
+	{
+		char buf[11];
+		snprintf(buf, sizeof(buf), "%04d-%02d-%02d", date.getYear(), date.getMonth(), date.getDay());
+		os.write(buf, 10);
+	}
+}
+
+BinaryTradeFile::BinaryTradeFile(const string& _filename) : file(_filename), filename(_filename)
+{
+	uint64_t size = file.size();
+	auto check = [&](uint64_t offset, uint64_t bytes) {
+		if (offset > size || bytes > size - offset || offset % 8 != 0)
+			throw std::runtime_error("Error: truncated trade file " + filename);
+	};
+
+	check(0, sizeof(Header));
+	memcpy(&header, file.data(), sizeof(Header));
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+		throw std::runtime_error("Error: " + filename + " is not a binary trade file");
+	if (header.version != VERSION)
+		throw std::runtime_error("Error: unsupported trade file version " + to_string(header.version));
+	if (header.endianTag != ENDIAN_TAG)
+		throw std::runtime_error("Error: trade file " + filename + " has a different byte order");
+	if (header.fileSize != size)
+		throw std::runtime_error("Error: truncated trade file " + filename);
+
+	check(header.swapOffset, uint64_t(header.nSwaps) * sizeof(SwapRecord));
+	check(header.bondOffset, uint64_t(header.nBonds) * sizeof(BondRecord));
+	check(header.europeanOffset, uint64_t(header.nEuropeans) * sizeof(OptionRecord));
+	check(header.americanOffset, uint64_t(header.nAmericans) * sizeof(OptionRecord));
+	if (header.stringOffset > size || header.stringSize > size - header.stringOffset)
+		throw std::runtime_error("Error: truncated trade file " + filename);
+
+	// every record is checked here once, so record() can read the mapping without checks.
+	// order maps a line of the text file to its record, counted across the sections
+	size_t n = this->size();
+	order.assign(n, UINT32_MAX);
+	uint32_t next = 0;
+	auto checkText = [&](StrRef ref) {
+		if (uint64_t(ref.offset) + ref.length > header.stringSize)
+			throw std::runtime_error("Error: corrupt string table in trade file " + filename);
+	};
+	auto place = [&](uint32_t seq, StrRef id, StrRef instrument, uint8_t direction) {
+		if (seq >= n || order[seq] != UINT32_MAX)
+			throw std::runtime_error("Error: corrupt record order in trade file " + filename);
+		checkText(id);
+		checkText(instrument);
+		directionName(direction);
+		order[seq] = next++;
+	};
+	for (uint32_t i = 0; i < header.nSwaps; ++i)
+		place(swaps()[i].seq, swaps()[i].id, swaps()[i].curve, swaps()[i].direction);
+	for (uint32_t i = 0; i < header.nBonds; ++i)
+		place(bonds()[i].seq, bonds()[i].id, bonds()[i].underlying, bonds()[i].direction);
+	auto placeOptions = [&](const OptionRecord* options, uint32_t count) {
+		for (uint32_t i = 0; i < count; ++i) {
+			place(options[i].seq, options[i].id, options[i].underlying, options[i].direction);
+			optionName(options[i].optType);
+		}
+	};
+	placeOptions(europeans(), header.nEuropeans);
+	placeOptions(americans(), header.nAmericans);
+}
+
+TradeRecord BinaryTradeFile::record(size_t line) const
+{
+	TradeRecord rec;
+	auto fill = [&](string_view type, StrRef id, StrRef instrument, int32_t tradeDate, int32_t startDate, int32_t endDate,
+		double notional, uint8_t direction) {
+		rec.id = str(id);
+		rec.type = type;
+		rec.instrument = str(instrument);
+		rec.tradeDate = Date::fromSerial(tradeDate);
+		rec.startDate = Date::fromSerial(startDate);
+		rec.endDate = Date::fromSerial(endDate);
+		rec.notional = notional;
+		rec.direction = directionName(direction);
+		rec.option = "na";
+	};
+
+	size_t i = order[line];
+	if (i < header.nSwaps) {
+		const SwapRecord& r = swaps()[i];
+		fill("swap", r.id, r.curve, r.tradeDate, r.startDate, r.endDate, r.notional, r.direction);
+		rec.rate = r.rate;
+		rec.strike = r.strike;
+		rec.freq = r.frequency;
+		return rec;
+	}
+	i -= header.nSwaps;
+	if (i < header.nBonds) {
+		const BondRecord& r = bonds()[i];
+		fill("bond", r.id, r.underlying, r.tradeDate, r.startDate, r.endDate, r.notional, r.direction);
+		rec.rate = r.coupon;
+		rec.strike = r.price;
+		rec.freq = r.frequency;
+		return rec;
+	}
+	i -= header.nBonds;
+	bool european = i < header.nEuropeans;
+	const OptionRecord& r = european ? europeans()[i] : americans()[i - header.nEuropeans];
+	fill(european ? "european" : "american", r.id, r.underlying, r.tradeDate, r.startDate, r.expiry, r.notional, r.direction);
+	rec.strike = r.strike;
+	rec.rate = r.rate;
+	rec.freq = r.frequency;
+	rec.option = optionName(r.optType);
+	return rec;
+}
+
+vector<TradeRecord> BinaryTradeFile::getRecords() const
+{
+	vector<TradeRecord> records;
+	records.reserve(size());
+	for (size_t line = 0; line < size(); ++line)
+		records.push_back(record(line));
+	return records;
+}
+
+void BinaryTradeFile::write(const vector<TradeRecord>& records, const string& filename)
+{
+	vector<SwapRecord> swapRecords;
+	vector<BondRecord> bondRecords;
+	vector<OptionRecord> europeanRecords;
+	vector<OptionRecord> americanRecords;
+	string strings;
+
+	// every distinct string is stored once, curve and underlying names are shared by many records
+	unordered_map<string_view, StrRef> interned;
+	auto addString = [&](string_view s) {
+		auto it = interned.find(s);
+		if (it != interned.end())
+			return it->second;
+		StrRef ref{ uint32_t(strings.size()), uint32_t(s.size()) };
+		strings.append(s.data(), s.size());
+		interned.emplace(s, ref);
+		return ref;
+	};
+
+	for (size_t i = 0; i < records.size(); ++i) {
+		const TradeRecord& rec = records[i];
+		uint32_t seq = uint32_t(i);
+		if (rec.type == "swap") {
+			SwapRecord r = {};
+			r.id = addString(rec.id);
+			r.curve = addString(rec.instrument);
+			r.seq = seq;
+			r.tradeDate = rec.tradeDate.serialDay();
+			r.startDate = rec.startDate.serialDay();
+			r.endDate = rec.endDate.serialDay();
+			r.notional = rec.notional;
+			r.rate = rec.rate;
+			r.frequency = rec.freq;
+			r.strike = rec.strike;
+			r.direction = toDirection(rec);
+			swapRecords.push_back(r);
+		}
+		else if (rec.type == "bond") {
+			BondRecord r = {};
+			r.id = addString(rec.id);
+			r.underlying = addString(rec.instrument);
+			r.seq = seq;
+			r.tradeDate = rec.tradeDate.serialDay();
+			r.startDate = rec.startDate.serialDay();
+			r.endDate = rec.endDate.serialDay();
+			r.notional = rec.notional;
+			r.coupon = rec.rate;
+			r.frequency = rec.freq;
+			r.price = rec.strike;
+			r.direction = toDirection(rec);
+			bondRecords.push_back(r);
+		}
+		else if (rec.type == "european" || rec.type == "american") {
+			OptionRecord r = {};
+			r.id = addString(rec.id);
+			r.underlying = addString(rec.instrument);
+			r.seq = seq;
+			r.tradeDate = rec.tradeDate.serialDay();
+			r.startDate = rec.startDate.serialDay();
+			r.expiry = rec.endDate.serialDay();
+			r.notional = rec.notional;
+			r.strike = rec.strike;
+			r.rate = rec.rate;
+			r.frequency = rec.freq;
+			r.direction = toDirection(rec);
+			r.optType = toOptionType(rec);
+			(rec.type == "european" ? europeanRecords : americanRecords).push_back(r);
+		}
+		else {
+			throw std::runtime_error("Error: unknown trade type " + string(rec.type) + " for trade " + string(rec.id));
+		}
+	}
+
+	Header header = {};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.endianTag = ENDIAN_TAG;
+	header.nSwaps = uint32_t(swapRecords.size());
+	header.nBonds = uint32_t(bondRecords.size());
+	header.nEuropeans = uint32_t(europeanRecords.size());
+	header.nAmericans = uint32_t(americanRecords.size());
+	header.swapOffset = sizeof(Header);
+	header.bondOffset = header.swapOffset + swapRecords.size() * sizeof(SwapRecord);
+	header.europeanOffset = header.bondOffset + bondRecords.size() * sizeof(BondRecord);
+	header.americanOffset = header.europeanOffset + europeanRecords.size() * sizeof(OptionRecord);
+	header.stringOffset = header.americanOffset + americanRecords.size() * sizeof(OptionRecord);
+	header.stringSize = strings.size();
+	header.fileSize = header.stringOffset + header.stringSize;
+
+	// written next to the target and renamed over it, readers never see a half written book
+	string tmpName = filename + ".tmp";
+	{
+		ofstream out(tmpName, ios::binary | ios::trunc);
+		if (!out)
+			throw std::runtime_error("Error opening file " + tmpName);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		out.write(reinterpret_cast<const char*>(swapRecords.data()), swapRecords.size() * sizeof(SwapRecord));
+		out.write(reinterpret_cast<const char*>(bondRecords.data()), bondRecords.size() * sizeof(BondRecord));
+		out.write(reinterpret_cast<const char*>(europeanRecords.data()), europeanRecords.size() * sizeof(OptionRecord));
+		out.write(reinterpret_cast<const char*>(americanRecords.data()), americanRecords.size() * sizeof(OptionRecord));
+		out.write(strings.data(), strings.size());
+		if (!out)
+			throw std::runtime_error("Error writing file " + tmpName);
+	}
+	std::filesystem::rename(tmpName, filename);
+}
+
+void writeTradeText(const vector<TradeRecord>& records, const string& filename)
+{
+	ofstream out(filename, ios::binary | ios::trunc);
+	if (!out)
+		throw std::runtime_error("Error opening file " + filename);
+
+	out << "id;type;trade_dt;start_dt;end_dt;notional;instrument;rate;strike;freq;option;direction\n";
+	for (const auto& rec : records) {
+		out << rec.id << ';' << rec.type << ';';
+		writeDate(out, rec.tradeDate);
+		out << ';';
+		writeDate(out, rec.startDate);
+		out << ';';
+		writeDate(out, rec.endDate);
+		out << ';';
+		writeNumber(out, rec.notional);
+		out << ';' << rec.instrument << ';';
+		writeNumber(out, rec.rate);
+		out << ';';
+		writeNumber(out, rec.strike);
+		out << ';';
+		writeNumber(out, rec.freq);
+		out << ';' << rec.option << ';' << rec.direction << '\n';
+	}
+}
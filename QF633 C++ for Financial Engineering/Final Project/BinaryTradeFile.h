@@ -0,0 +1,139 @@
+#ifndef BINARY_TRADE_FILE_H
+#define BINARY_TRADE_FILE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "MappedFile.h"
+#include "TradeLoader.h"
+
+using namespace std;
+
+// On-disk layout of the binary trade book. Little endian, sections 8 byte aligned.
+//
+//   Header
+//   SwapRecord[nSwaps], BondRecord[nBonds], OptionRecord[nEuropeans], OptionRecord[nAmericans]
+//   string table, ids and instrument names are referenced by offset and length, each distinct
+//   string is stored once
+//
+// Records are grouped per product, seq keeps the line order of the text file. Every numeric
+// column of trade.txt is stored for every product, the option column of a swap or bond is
+// always "na". Bump VERSION whenever any of the structs below changes.
+namespace TRADEFILE
+{
+	constexpr char MAGIC[8] = { 'Q', 'F', 'T', 'R', 'A', 'D', 'E', 'S' };
+	constexpr uint32_t VERSION = 2;
+	constexpr uint32_t ENDIAN_TAG = 0x01020304;
+
+	enum Direction : uint8_t { Pay, Receive, Long, Short };
+
+	struct StrRef {
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t endianTag;
+		uint32_t nSwaps;
+		uint32_t nBonds;
+		uint32_t nEuropeans;
+		uint32_t nAmericans;
+		uint64_t swapOffset;
+		uint64_t bondOffset;
+		uint64_t europeanOffset;
+		uint64_t americanOffset;
+		uint64_t stringOffset;
+		uint64_t stringSize;
+		uint64_t fileSize;
+	};
+
+	struct SwapRecord {
+		StrRef id;
+		StrRef curve;
+		uint32_t seq;
+		int32_t tradeDate; // serial days
+		int32_t startDate;
+		int32_t endDate;
+		double notional;
+		double rate;
+		double frequency;
+		double strike; // unused by a swap, kept so the text columns round trip
+		uint8_t direction;
+		uint8_t reserved[7];
+	};
+
+	struct BondRecord {
+		StrRef id;
+		StrRef underlying;
+		uint32_t seq;
+		int32_t tradeDate;
+		int32_t startDate;
+		int32_t endDate;
+		double notional;
+		double coupon;
+		double frequency;
+		double price; // the strike column of trade.txt
+		uint8_t direction;
+		uint8_t reserved[7];
+	};
+
+	struct OptionRecord {
+		StrRef id;
+		StrRef underlying;
+		uint32_t seq;
+		int32_t tradeDate;
+		int32_t startDate;
+		int32_t expiry;
+		double notional;
+		double strike;
+		double rate;      // unused by an option, kept so the text columns round trip
+		double frequency; // same
+		uint8_t direction;
+		uint8_t optType; // OptionType
+		uint8_t reserved[6];
+	};
+
+	static_assert(sizeof(Header) % 8 == 0, "trade file header must stay 8 byte aligned");
+	static_assert(sizeof(SwapRecord) % 8 == 0 && sizeof(BondRecord) % 8 == 0 && sizeof(OptionRecord) % 8 == 0,
+		"trade file records must stay 8 byte aligned");
+}
+
+// Read only view of a binary trade book. The file is memory mapped and every record is checked
+// once when it is opened. record() then reads one line straight from the mapping, its text
+// fields point into the mapping, so buildTrades and addToStore build from the book with no
+// parsing and no intermediate copy of the records.
+class BinaryTradeFile
+{
+public:
+	explicit BinaryTradeFile(const string& filename);
+
+	// line of the original text file, valid while this object lives
+	TradeRecord record(size_t line) const;
+	// all of them in line order, for the conversion back to text
+	vector<TradeRecord> getRecords() const;
+
+	inline size_t size() const { return size_t(header.nSwaps) + header.nBonds + header.nEuropeans + header.nAmericans; }
+	inline const TRADEFILE::SwapRecord* swaps() const { return reinterpret_cast<const TRADEFILE::SwapRecord*>(file.data() + header.swapOffset); }
+	inline const TRADEFILE::BondRecord* bonds() const { return reinterpret_cast<const TRADEFILE::BondRecord*>(file.data() + header.bondOffset); }
+	inline const TRADEFILE::OptionRecord* europeans() const { return reinterpret_cast<const TRADEFILE::OptionRecord*>(file.data() + header.europeanOffset); }
+	inline const TRADEFILE::OptionRecord* americans() const { return reinterpret_cast<const TRADEFILE::OptionRecord*>(file.data() + header.americanOffset); }
+	inline string_view str(TRADEFILE::StrRef ref) const { return string_view(file.data() + header.stringOffset + ref.offset, ref.length); }
+
+	// text records (e.g. from TradeFileLoader) to the binary layout
+	static void write(const vector<TradeRecord>& records, const string& filename);
+
+private:
+	MappedFile file;
+	TRADEFILE::Header header;
+	string filename;
+	vector<uint32_t> order; // line of the text file -> record, counted across the sections
+};
+
+// records back to the trade.txt layout
+void writeTradeText(const vector<TradeRecord>& records, const string& filename);
+
+#endif
@@ -6,24 +6,60 @@ double Bond::Payoff(double s) const
 	return pv;
 }
 
+const CashflowPlan& Bond::schedulePlan(const RateCurve& rc, CashflowPlan& scratch) const
+{
+	if (plan.matches(rc.getAnchor(), valuedate))
+		return plan;
+
+	// coupon dates plus the principal at maturity
+	scratch.anchor = rc.getAnchor();
+	scratch.valueDate = valuedate;
+	scratch.times.clear();
+	const auto& dates = schedule->dates;
+	// the schedule's own times hold when the curve is anchored on its value date
+	bool cachedTimes = schedule->valueDate == rc.getAnchor();
+	scratch.times.reserve(dates.size() + 1);
+	for (size_t i = 0; i < dates.size(); ++i) {
+		Date dt = dates[i];
+		if (dt - valuedate < 0)
+			continue;
+		scratch.times.push_back(cachedTimes ? schedule->times[i] : yearFraction(rc.getAnchor(), dt));
+	}
+	scratch.times.push_back(yearFraction(rc.getAnchor(), endDate));
+	scratch.ready = true;
+	return scratch;
+}
+
+void Bond::compile(const Market& mkt)
+{
+	resolveHandles(mkt);
+	plan.ready = false;
+	if (!curveHandle.valid())
+		return; // priced by name, without a plan
+	CashflowPlan built;
+	plan = schedulePlan(discountCurve(mkt), built);
+}
+
 double Bond::Pv(const Market& mkt) const {
 	double couponPayment = coupon_rate * frequency * 100;
 	double bondValue = 0.0;
-	auto rc = mkt.getCurve(curvename);
+	const RateCurve& rc = discountCurve(mkt);
+
+	// discounted in one batch
+	CashflowPlan scratch;
+	const vector<double>& times = schedulePlan(rc, scratch).times;
+	vector<double> dfs(times.size());
+	rc.getDf(times.data(), dfs.data(), times.size());
 
 	// discounting cash flow
-	for (size_t i = 0; i < cashflowDates.size(); ++i) {
-		Date dt = cashflowDates[i];
-		if (dt - valuedate < 0)
-			continue;
-		double df = rc->getDf(dt, valuedate);
-		bondValue += couponPayment * df;
+	for (size_t i = 0; i + 1 < dfs.size(); ++i) {
+		bondValue += couponPayment * dfs[i];
 	}
 
 	// Discount the principal (notional) value to the present
-	bondValue += 100 * rc->getDf(endDate, valuedate);
+	bondValue += 100 * dfs.back();
 	double pv = bondValue / 100.0 * bondNotional;
 
 
 	return direction == "long" ? pv : -pv;
-}
\ No newline at end of file
+}
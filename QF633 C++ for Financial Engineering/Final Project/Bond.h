@@ -1,12 +1,13 @@
 #pragma once
 #include "Trade.h"
 #include "Market.h"
+#include "ScheduleCache.h"
 
 class Bond : public Trade {
 
 public:
 	Bond(const string& trade_id, const std::string& name, const Date& tradeDate, const Date& today, Date& start, const Date& end,
-		double notional, double rate, RateCurve* rateCurve, double couponFreq, double price) : Trade(trade_id, "BondTrade", "Bond_" + to_string(rate) + "_" + to_string(end.year) + "-" + to_string(end.month) + "-" + to_string(end.day), tradeDate) {
+		double notional, double rate, RateCurve* rateCurve, double couponFreq, double price) : Trade(trade_id, "BondTrade", "Bond_" + to_string(rate) + "_" + to_string(end.getYear()) + "-" + to_string(end.getMonth()) + "-" + to_string(end.getDay()), tradeDate) {
 		startDate = start;
 		endDate = end;
 		valuedate = today;
@@ -32,12 +33,16 @@ public:
 	}
 	inline void setUnderlying(const string& _underlying) {
 		underlying = _underlying;
+		curvename = curveForUnderlying(_underlying);
+	}
+	// discount curve from the currency prefix of the bond name
+	static inline string curveForUnderlying(const string& _underlying) {
 		string currency = _underlying.substr(0, 3);
 		if (currency == "USD") {
-			curvename = "USD-SOFR";
+			return "USD-SOFR";
 		}
 		else if (currency == "SGD") {
-			curvename = "SGD-SORA";
+			return "SGD-SORA";
 		}
 		else {
 			throw std::runtime_error("NO CURVE FOR CURRENCY: " + currency);
@@ -61,9 +66,9 @@ public:
 	inline void updateBondName() {
 		tradeName = direction +
 			"_Bond_" + to_string(coupon_rate) + "_" +
-			to_string(endDate.year) + "-" +
-			to_string(endDate.month) + "-" +
-			to_string(endDate.day);
+			to_string(endDate.getYear()) + "-" +
+			to_string(endDate.getMonth()) + "-" +
+			to_string(endDate.getDay());
 	}
 	inline void updateBaseTradeName() {
 		updateTradeName(tradeName);
@@ -75,25 +80,37 @@ public:
 	inline string getVolname() const override { return ""; }
 	inline double getNotional() const override { return bondNotional; }
 	inline string getDirection() const override { return direction; }
+	inline double getCoupon() const { return coupon_rate; }
+	inline double getFrequency() const { return frequency; }
+	inline const Date& getEndDate() const { return endDate; }
+	inline const vector<Date>& getCashflowDates() const { return schedule->dates; }
+	inline const shared_ptr<const Schedule>& getSchedule() const { return schedule; }
+	inline vector<Date> getRiskDates() const override {
+		vector<Date> dates(schedule->dates);
+		dates.push_back(endDate);
+		return dates;
+	}
 
 	// pricers
+	// shared with every trade on the same (start, end, frequency, value date)
 	void inline generateBondSchedule() {
-		if (startDate - endDate >= 0 || frequency <= 0 || frequency > 1)
-			throw std::runtime_error("Error: start date is later than end date, or invalid frequency!");
-
-		Date interim = startDate;
-		while (endDate - interim >= 0) {
-			if (interim - valuedate >= 0) {
-				cashflowDates.push_back(interim);
-			}
-			interim = interim.addMonths(12.0 * frequency);
-		}
-
+		schedule = ScheduleCache::global().get(startDate, endDate, frequency, valuedate);
 	}
 	double Payoff(double s) const;
 	double Pv(const Market& mkt) const;
+	void compile(const Market& mkt) override;
+	inline void hashTerms(HASH::Hasher& h) const override {
+		Trade::hashTerms(h);
+		h.add(coupon_rate);
+		h.add(frequency);
+		h.add(tradePrice);
+		h.add(startDate);
+		h.add(valuedate);
+	}
 
 private:
+	const CashflowPlan& schedulePlan(const RateCurve& rc, CashflowPlan& scratch) const;
+
 	string tradeName;
 	string underlying;
 	double bondNotional;
@@ -104,7 +121,8 @@ private:
 	Date startDate;
 	Date endDate;
 	Date valuedate;
-	vector<Date> cashflowDates;
+	shared_ptr<const Schedule> schedule = Schedule::empty();
+	CashflowPlan plan;
 	string direction;
 };
 
@@ -0,0 +1,130 @@
+#include <cmath>
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+
+#include "Bootstrapper.h"
+#include "Swap.h"
+
+Date addTenor(const Date& date, const string& tenor)
+{
+	if (tenor == "ON")
+		return date.addDays(1);
+	if (tenor.size() < 2)
+		throw std::runtime_error("Error: invalid tenor " + tenor);
+
+	int n = stoi(tenor.substr(0, tenor.size() - 1));
+	switch (toupper(tenor.back()))
+	{
+	case 'D':
+		return date.addDays(n);
+	case 'W':
+		return date.addDays(7 * n);
+	case 'M':
+		return date.addMonths(n);
+	case 'Y':
+		return date.addYears(n);
+	default:
+		throw std::runtime_error("Error: invalid tenor " + tenor);
+	}
+}
+
+shared_ptr<RateCurve> CurveBootstrapper::bootstrap(const string& name, vector<CurveQuote> quotes) const
+{
+	std::sort(quotes.begin(), quotes.end(), [](const CurveQuote& a, const CurveQuote& b) { return a.maturity < b.maturity; });
+
+	auto curve = make_shared<RateCurve>(name);
+	double lastTime = 0;
+	double lastZero = 0;
+	for (const auto& quote : quotes) {
+		double t = yearFraction(valueDate, quote.maturity);
+		if (t <= 0)
+			throw std::runtime_error("Error: quote " + quote.tenor + " on " + name + " does not mature after the value date");
+
+		double zero;
+		if (quote.type == Deposit) {
+			double df = 1.0 / (1.0 + quote.rate * yearFraction(valueDate, quote.maturity, ACT360));
+			zero = -log(df) / t;
+		}
+		else {
+			zero = solveSwapPillar(name, *curve, lastTime, lastZero, quote);
+		}
+
+		curve->addRate(quote.maturity, zero);
+		curve->compile(valueDate);
+		lastTime = t;
+		lastZero = zero;
+	}
+
+	return curve;
+}
+
+double CurveBootstrapper::solveSwapPillar(const string& name, const RateCurve& known, double lastPillarTime, double lastZero, const CurveQuote& quote) const
+{
+	// unit notional par swap on the quote, scheduled exactly like a booked swap
+	Swap swap(name + "_" + quote.tenor, valueDate, valueDate, quote.maturity);
+	swap.setValueDate(valueDate);
+	swap.setFrequency(swapFrequency);
+	swap.setNotional(1.0);
+	swap.setRate(quote.rate);
+	swap.setCurvename(name);
+	swap.generateSwapSchedule();
+	const vector<Date>& dates = swap.getCashflowDates();
+
+	// par condition as in Swap::Pv: K * sum(tau_i * df_i) + df(T) - 1 = 0.
+	// Periods paying on the known part of the curve are constant; on the new segment
+	// r(t) = lastZero + (z - lastZero) * w(t), so d df / dz = -t * w * df.
+	double tn = yearFraction(valueDate, quote.maturity);
+	bool hasPillar = known.isCompiled();
+	double fixedKnown = 0;
+	vector<double> taus, times, weights;
+	for (size_t i = 1; i < dates.size(); i++) {
+		double tau = (dates[i] - dates[i - 1]) / 360;
+		double t = yearFraction(valueDate, dates[i]);
+		if (hasPillar && t <= lastPillarTime) {
+			fixedKnown += tau * exp(-known.getRate(t) * t);
+		}
+		else {
+			taus.push_back(tau);
+			times.push_back(t);
+			// before the first pillar the curve is flat at the new zero rate
+			weights.push_back(hasPillar ? (t - lastPillarTime) / (tn - lastPillarTime) : 1.0);
+		}
+	}
+
+	double z = hasPillar ? lastZero : quote.rate;
+	for (int iter = 0; iter < maxIterations; ++iter) {
+		double dfEnd = exp(-z * tn);
+		double f = quote.rate * fixedKnown + dfEnd - 1;
+		double fPrime = -tn * dfEnd;
+		for (size_t j = 0; j < taus.size(); ++j) {
+			double r = lastZero + (z - lastZero) * weights[j];
+			double df = exp(-r * times[j]);
+			f += quote.rate * taus[j] * df;
+			fPrime -= quote.rate * taus[j] * times[j] * weights[j] * df;
+		}
+
+		double step = f / fPrime;
+		z -= step;
+		if (fabs(step) < tolerance)
+			return z;
+	}
+
+	throw std::runtime_error("Error: bootstrap did not converge for " + name + " " + quote.tenor);
+}
+
+map<string, shared_ptr<RateCurve>> CurveBootstrapper::bootstrap(const map<string, vector<CurveQuote>>& quotes, ThreadPool& pool) const
+{
+	vector<pair<string, std::future<shared_ptr<RateCurve>>>> pending;
+	for (const auto& kv : quotes) {
+		auto task = make_shared<std::packaged_task<shared_ptr<RateCurve>()>>([this, &kv] { return bootstrap(kv.first, kv.second); });
+		pending.emplace_back(kv.first, task->get_future());
+		pool.enqueue([task] { (*task)(); });
+	}
+
+	map<string, shared_ptr<RateCurve>> curves;
+	for (auto& p : pending) {
+		curves.emplace(p.first, p.second.get());
+	}
+	return curves;
+}
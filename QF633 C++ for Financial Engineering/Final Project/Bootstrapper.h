@@ -0,0 +1,56 @@
+#ifndef BOOTSTRAPPER_H
+#define BOOTSTRAPPER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+#include "Date.h"
+#include "Market.h"
+#include "threadpool.h"
+
+using namespace std;
+
+enum QuoteType
+{
+	Deposit,  // simple rate, ACT/360
+	ParSwap   // fixed vs compounded overnight par rate, fixed leg ACT/360
+};
+
+struct CurveQuote {
+	string tenor;
+	Date maturity;
+	double rate;
+	QuoteType type;
+};
+
+// date + tenor string such as "ON", "1W", "3M", "10Y"
+Date addTenor(const Date& date, const string& tenor);
+
+// Builds a linear-zero RateCurve that reprices deposit and par swap quotes exactly.
+// Pillars are solved one at a time in maturity order. A swap pillar is a 1-d Newton solve
+// for the new zero rate, using the same schedule and cashflow definition as Swap::Pv and
+// analytic derivatives of the discount factors on the segment being solved.
+class CurveBootstrapper
+{
+public:
+	CurveBootstrapper(const Date& _valueDate, double _swapFrequency = 1.0)
+		: valueDate(_valueDate), swapFrequency(_swapFrequency) {};
+
+	shared_ptr<RateCurve> bootstrap(const string& name, vector<CurveQuote> quotes) const;
+
+	// independent currencies are solved in parallel on the pool
+	map<string, shared_ptr<RateCurve>> bootstrap(const map<string, vector<CurveQuote>>& quotes, ThreadPool& pool) const;
+
+private:
+	double solveSwapPillar(const string& name, const RateCurve& known, double lastPillarTime, double lastZero, const CurveQuote& quote) const;
+
+	Date valueDate;
+	double swapFrequency;
+
+	static const int maxIterations = 50;
+	static constexpr double tolerance = 1e-12; // on the zero rate
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include <algorithm>
+
+#include "CashflowStore.h"
+#include "PortfolioStore.h"
+
+CashflowStore::CashflowStore(const Market& mkt, const vector<shared_ptr<Trade>>& trades)
+{
+	// linear trades by curve, book order within a curve
+	vector<pair<int32_t, size_t>> linear;
+	for (size_t i = 0; i < trades.size(); ++i) {
+		if (LinearTable::isLinear(*trades[i])) {
+			CurveHandle h = mkt.getCurveHandle(trades[i]->getCurvename());
+			if (!h.valid())
+				throw std::runtime_error("Error: unknown curve " + trades[i]->getCurvename() + " for trade " + trades[i]->getTradeid());
+			linear.emplace_back(h.id, i);
+		}
+	}
+	std::stable_sort(linear.begin(), linear.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	// the cashflow rules are LinearTable's, row k of flows is stored trade k. amounts here
+	// carry the sign and the notional
+	LinearTable flows;
+	for (const auto& entry : linear) {
+		if (segments.empty() || segments.back().curve != entry.first) {
+			int32_t anchor = mkt.getCurve(CurveHandle{ entry.first }).getAnchor().serialDay();
+			uint32_t k = uint32_t(source.size());
+			uint32_t j = uint32_t(cfAmount.size());
+			segments.push_back({ entry.first, anchor, k, k, j, j, 0, 0, 0.0 });
+		}
+		uint32_t k = uint32_t(source.size());
+		source.push_back(uint32_t(entry.second));
+		flows.addTrade(k, entry.first, *trades[entry.second]);
+
+		double n = flows.sign[k] * flows.notional[k];
+		constant.push_back(n * flows.fixed[k]);
+		for (size_t j = flows.cfBegin[k]; j < flows.cfBegin[k + 1]; ++j) {
+			cfDay.push_back(flows.cfDate[j]);
+			cfAmount.push_back(n * flows.cfWeight[j]);
+			cfTrade.push_back(k);
+		}
+
+		segments.back().tradeEnd = uint32_t(source.size());
+		segments.back().cfEnd = uint32_t(cfAmount.size());
+		segments.back().constant += constant.back();
+	}
+
+	cfNode.resize(cfDay.size());
+	for (auto& seg : segments)
+		buildLadder(seg);
+}
+
+void CashflowStore::buildLadder(Segment& seg)
+{
+	// one node per distinct payment date on the curve
+	vector<int32_t> days(cfDay.begin() + seg.cfBegin, cfDay.begin() + seg.cfEnd);
+	std::sort(days.begin(), days.end());
+	days.erase(std::unique(days.begin(), days.end()), days.end());
+
+	seg.nodeBegin = uint32_t(nodeDay.size());
+	for (int32_t day : days) {
+		nodeDay.push_back(day);
+		nodeTime.push_back((day - seg.anchor) / 365.0);
+		nodeAmount.push_back(0.0);
+	}
+	seg.nodeEnd = uint32_t(nodeDay.size());
+
+	for (size_t j = seg.cfBegin; j < seg.cfEnd; ++j) {
+		uint32_t node = seg.nodeBegin + uint32_t(std::lower_bound(days.begin(), days.end(), cfDay[j]) - days.begin());
+		cfNode[j] = node;
+		nodeAmount[node] += cfAmount[j];
+	}
+}
+
+const double* CashflowStore::discountNodes(const Market& mkt, const Segment& seg, vector<double>& t, vector<double>& df) const
+{
+	// df[i] belongs to node seg.nodeBegin + i
+	const RateCurve& rc = mkt.getCurve(CurveHandle{ seg.curve });
+	size_t n = seg.nodeEnd - seg.nodeBegin;
+	const double* times = nodeTime.data() + seg.nodeBegin;
+	if (rc.getAnchor().serialDay() != seg.anchor) {
+		int32_t anchor = rc.getAnchor().serialDay();
+		t.resize(n);
+		for (size_t i = 0; i < n; ++i)
+			t[i] = (nodeDay[seg.nodeBegin + i] - anchor) / 365.0;
+		times = t.data();
+	}
+	df.resize(n);
+	rc.getDf(times, df.data(), n);
+	return df.data();
+}
+
+void CashflowStore::priceSegment(const Market& mkt, const Segment& seg, double* pv, vector<double>& t, vector<double>& df) const
+{
+	const double* nodeDf = discountNodes(mkt, seg, t, df) - seg.nodeBegin;
+
+	for (size_t k = seg.tradeBegin; k < seg.tradeEnd; ++k)
+		pv[k] = constant[k];
+	for (size_t j = seg.cfBegin; j < seg.cfEnd; ++j)
+		pv[cfTrade[j]] += cfAmount[j] * nodeDf[cfNode[j]];
+}
+
+double CashflowStore::segmentPv(const Market& mkt, const Segment& seg, vector<double>& t, vector<double>& df) const
+{
+	const double* nodeDf = discountNodes(mkt, seg, t, df);
+	const double* amount = nodeAmount.data() + seg.nodeBegin;
+	double pv = seg.constant;
+	for (size_t i = 0; i < seg.nodeEnd - seg.nodeBegin; ++i)
+		pv += amount[i] * nodeDf[i];
+	return pv;
+}
+
+vector<double> CashflowStore::price(const Market& mkt) const
+{
+	vector<double> pv(size());
+	vector<double> t, df;
+	for (const auto& seg : segments)
+		priceSegment(mkt, seg, pv.data(), t, df);
+	return pv;
+}
+
+double CashflowStore::bookPv(const Market& mkt) const
+{
+	double pv = 0;
+	vector<double> t, df;
+	for (const auto& seg : segments)
+		pv += segmentPv(mkt, seg, t, df);
+	return pv;
+}
+
+double CashflowStore::curvePv(const Market& mkt, CurveHandle curve) const
+{
+	double pv = 0;
+	vector<double> t, df;
+	for (const auto& seg : segments)
+		if (seg.curve == curve.id)
+			pv += segmentPv(mkt, seg, t, df);
+	return pv;
+}
+
+void CashflowStore::reprice(const Market& mkt, CurveHandle curve, vector<double>& pv) const
+{
+	pv.resize(size());
+	vector<double> t, df;
+	for (const auto& seg : segments)
+		if (seg.curve == curve.id)
+			priceSegment(mkt, seg, pv.data(), t, df);
+}
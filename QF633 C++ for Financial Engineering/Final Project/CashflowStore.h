@@ -0,0 +1,88 @@
+#ifndef CASHFLOW_STORE_H
+#define CASHFLOW_STORE_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "Market.h"
+#include "Trade.h"
+
+using namespace std;
+
+// Every fixed cashflow of the swaps and bonds of a book in flat arrays, grouped by curve.
+// Amounts carry the notional and the sign, so a trade's pv is its constant (the swap float
+// leg) plus the sum of amount * df over its cashflows.
+//
+// Cashflows on the same curve and date are netted into one node of a compressed ladder, the
+// ladder is what gets discounted (one batch per curve). Each cashflow keeps the node it went
+// into, per trade pv is gathered back from the node dfs; book and per curve pv never leave
+// the ladder.
+//
+// Times are years from the curve anchors of the market the store was built with, a market
+// with other anchors gets them recomputed from the dates.
+class CashflowStore
+{
+public:
+	// other products in trades are left out
+	CashflowStore(const Market& mkt, const vector<shared_ptr<Trade>>& trades);
+
+	// pv per stored trade
+	vector<double> price(const Market& mkt) const;
+	// only the trades on one curve are re-discounted (e.g. against a bumped copy of it), the
+	// rest of pv is left as it is
+	void reprice(const Market& mkt, CurveHandle curve, vector<double>& pv) const;
+
+	// sum over the stored trades, from the netted ladder
+	double bookPv(const Market& mkt) const;
+	// same for the trades on one curve, (curvePv(up) - curvePv(down)) / 2 is the book dv01
+	double curvePv(const Market& mkt, CurveHandle curve) const;
+
+	inline size_t size() const { return source.size(); }
+	inline size_t cashflows() const { return cfAmount.size(); }
+	inline size_t nodes() const { return nodeAmount.size(); }
+	// position of stored trade k in the vector the store was built from
+	inline size_t getSource(size_t k) const { return source[k]; }
+	// stored trade cashflow j belongs to, and the ladder node it was netted into
+	inline size_t getTrade(size_t j) const { return cfTrade[j]; }
+	inline size_t getNode(size_t j) const { return cfNode[j]; }
+
+private:
+	// the trades [tradeBegin, tradeEnd), their cashflows [cfBegin, cfEnd) and ladder nodes
+	// [nodeBegin, nodeEnd) on one curve
+	struct Segment {
+		int32_t curve;
+		int32_t anchor;   // serial day the times were worked out from
+		uint32_t tradeBegin;
+		uint32_t tradeEnd;
+		uint32_t cfBegin;
+		uint32_t cfEnd;
+		uint32_t nodeBegin;
+		uint32_t nodeEnd;
+		double constant;  // sum of the trade constants
+	};
+
+	void buildLadder(Segment& seg);
+	const double* discountNodes(const Market& mkt, const Segment& seg, vector<double>& t, vector<double>& df) const;
+	void priceSegment(const Market& mkt, const Segment& seg, double* pv, vector<double>& t, vector<double>& df) const;
+	double segmentPv(const Market& mkt, const Segment& seg, vector<double>& t, vector<double>& df) const;
+
+	vector<Segment> segments;
+
+	// per trade
+	vector<uint32_t> source;
+	vector<double> constant;
+
+	// per cashflow
+	vector<int32_t> cfDay;
+	vector<double> cfAmount;
+	vector<uint32_t> cfTrade;
+	vector<uint32_t> cfNode;
+
+	// per ladder node, dates ascending within a segment
+	vector<int32_t> nodeDay;
+	vector<double> nodeTime;
+	vector<double> nodeAmount;
+};
+
+#endif
@@ -2,36 +2,113 @@
 #define DATE_H
 
 #include <iostream>
+#include <cstdint>
+#include <functional>
 
+// Date is backed by a serial day count (days since 1970-01-01) so that comparison,
+// subtraction and day arithmetic are single integer operations. The civil fields are
+// kept alongside for printing and month/year rolls. A Date is immutable, build a new
+// one (addDays, addMonths, ...) when the calendar date has to change.
 class Date
 {
 public:
-	int year = 0;
-	int month = 0;
-	int day = 0;
-	Date(int y, int m, int d) : year(y), month(m), day(d) {};
-	Date() {
-		//std::cout << "default Date constructor called" << std::endl;
-	};
+	constexpr Date(int y, int m, int d) : year(y), month(m), day(d), serial(daysFromCivil(y, m, d)) {};
+	constexpr Date() {};
+
+	static constexpr Date fromSerial(int32_t serialDay) {
+		Date result;
+		civilFromDays(serialDay, result.year, result.month, result.day);
+		result.serial = serialDay;
+		return result;
+	}
+
+	constexpr int32_t serialDay() const { return serial; }
+	constexpr int getYear() const { return year; }
+	constexpr int getMonth() const { return month; }
+	constexpr int getDay() const { return day; }
+
+	constexpr Date addDays(int days) const { return fromSerial(serial + days); }
 
-	Date addDays(int days) const;
+	constexpr Date addMonths(int months) const {
+		int m = year * 12 + (month - 1) + months;
+		int y = m >= 0 ? m / 12 : (m - 11) / 12;
+		m = m - y * 12 + 1;
+		int d = day < daysInMonth(y, m) ? day : daysInMonth(y, m);
+		return Date(y, m, d);
+	}
 
-	Date addMonths(int months) const;
+	constexpr Date addYears(int years) const { return addMonths(12 * years); }
 
-	Date addYears(int years) const;
+	constexpr bool isLeapYear() const { return isLeapYear(year); }
 
-	bool isLeapYear() const;
+	constexpr int daysInMonth() const { return daysInMonth(year, month); }
 
-	int daysInMonth() const;
+	static constexpr bool isLeapYear(int y) {
+		return (y % 4 == 0 && (y % 100 != 0 || y % 400 == 0));
+	}
+
+	static constexpr int daysInMonth(int y, int m) {
+		return m == 2 ? (isLeapYear(y) ? 29 : 28) : (m == 4 || m == 6 || m == 9 || m == 11) ? 30 : 31;
+	}
+
+	// days since 1970-01-01 for a proleptic gregorian date, O(1) (H. Hinnant's algorithm)
+	static constexpr int32_t daysFromCivil(int y, int m, int d) {
+		y -= m <= 2;
+		const int era = (y >= 0 ? y : y - 399) / 400;
+		const int yoe = y - era * 400;
+		const int doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+		const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		return era * 146097 + doe - 719468;
+	}
+
+	static constexpr void civilFromDays(int32_t z, int& y, int& m, int& d) {
+		z += 719468;
+		const int era = (z >= 0 ? z : z - 146096) / 146097;
+		const int doe = z - era * 146097;
+		const int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+		const int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+		const int mp = (5 * doy + 2) / 153;
+		d = doy - (153 * mp + 2) / 5 + 1;
+		m = mp < 10 ? mp + 3 : mp - 9;
+		y = yoe + era * 400 + (m <= 2);
+	}
 
-	void normalize();
 private:
-	static const int days_in_months[12];
+	int year = 1970;
+	int month = 1;
+	int day = 1;
+	int32_t serial = 0;
 };
 
-double operator-(const Date& d1, const Date& d2);
-bool operator==(const Date& d1, const Date& d2);
+enum DayCount
+{
+	ACT365F,
+	ACT360
+};
+
+// return date difference in days
+constexpr double operator-(const Date& d1, const Date& d2) { return d1.serialDay() - d2.serialDay(); }
+
+// year fraction between two dates under the given day count convention
+constexpr double yearFraction(const Date& from, const Date& to, DayCount dc = ACT365F) {
+	return (to - from) / (dc == ACT360 ? 360.0 : 365.0);
+}
+
+constexpr bool operator==(const Date& d1, const Date& d2) { return d1.serialDay() == d2.serialDay(); }
+constexpr bool operator!=(const Date& d1, const Date& d2) { return d1.serialDay() != d2.serialDay(); }
+constexpr bool operator<(const Date& d1, const Date& d2) { return d1.serialDay() < d2.serialDay(); }
+constexpr bool operator>(const Date& d1, const Date& d2) { return d1.serialDay() > d2.serialDay(); }
+constexpr bool operator<=(const Date& d1, const Date& d2) { return d1.serialDay() <= d2.serialDay(); }
+constexpr bool operator>=(const Date& d1, const Date& d2) { return d1.serialDay() >= d2.serialDay(); }
+
 std::ostream& operator<<(std::ostream& os, const Date& date);
 std::istream& operator>>(std::istream& is, Date& date);
 
+namespace std {
+	template <>
+	struct hash<Date> {
+		size_t operator()(const Date& d) const noexcept { return std::hash<int32_t>()(d.serialDay()); }
+	};
+}
+
 #endif
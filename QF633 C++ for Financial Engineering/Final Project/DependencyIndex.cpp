@@ -0,0 +1,44 @@
+#include "DependencyIndex.h"
+
+DependencyIndex::DependencyIndex(const vector<shared_ptr<Trade>>& trades)
+{
+	for (size_t i = 0; i < trades.size(); ++i)
+		add(i, *trades[i]);
+}
+
+void DependencyIndex::add(size_t pos, const Trade& trade)
+{
+	// swaps and bonds have no vol name, they never show up under a vol
+	string curve = trade.getCurvename();
+	if (!curve.empty())
+		curves[curve].push_back(pos);
+	string vol = trade.getVolname();
+	if (!vol.empty())
+		vols[vol].push_back(pos);
+	string underlying = trade.getUnderlying();
+	if (!underlying.empty())
+		prices[underlying].push_back(pos);
+	++nTrades;
+}
+
+const vector<size_t>& DependencyIndex::lookup(const unordered_map<string, vector<size_t>>& deps, const string& name)
+{
+	static const vector<size_t> none;
+	auto it = deps.find(name);
+	return it == deps.end() ? none : it->second;
+}
+
+const vector<size_t>& DependencyIndex::curveDependents(const string& curve) const
+{
+	return lookup(curves, curve);
+}
+
+const vector<size_t>& DependencyIndex::volDependents(const string& vol) const
+{
+	return lookup(vols, vol);
+}
+
+const vector<size_t>& DependencyIndex::priceDependents(const string& underlying) const
+{
+	return lookup(prices, underlying);
+}
@@ -0,0 +1,40 @@
+#ifndef DEPENDENCY_INDEX_H
+#define DEPENDENCY_INDEX_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "Trade.h"
+
+using namespace std;
+
+// Risk factor -> trades that read it, built from each trade's curve, vol and underlying names.
+// Trades are referred to by their position in the vector the index was built from. A bump
+// only needs to reprice the dependents of the factor it moves.
+class DependencyIndex
+{
+public:
+	DependencyIndex() {};
+	explicit DependencyIndex(const vector<shared_ptr<Trade>>& trades);
+
+	void add(size_t pos, const Trade& trade);
+
+	// empty when nothing depends on the factor
+	const vector<size_t>& curveDependents(const string& curve) const;
+	const vector<size_t>& volDependents(const string& vol) const;
+	const vector<size_t>& priceDependents(const string& underlying) const;
+
+	inline size_t size() const { return nTrades; }
+
+private:
+	static const vector<size_t>& lookup(const unordered_map<string, vector<size_t>>& deps, const string& name);
+
+	unordered_map<string, vector<size_t>> curves;
+	unordered_map<string, vector<size_t>> vols;
+	unordered_map<string, vector<size_t>> prices;
+	size_t nTrades = 0;
+};
+
+#endif
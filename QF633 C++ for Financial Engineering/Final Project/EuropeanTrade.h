@@ -12,8 +12,9 @@ public:
 	EuropeanOption() {};
 	EuropeanOption(const string& _trade_id, const string& trade_name) : TreeProduct(_trade_id, trade_name) {};
 	EuropeanOption(const string& _trade_id, double _notional, OptionType _optType, double _strike, const Date& _expiry, const string& _underlying)
-		: TreeProduct(_trade_id, "EU_" + to_string(_strike) + "_" + to_string(_optType) + "_" + _underlying + "_" + to_string(_expiry.year) + "-" + to_string(_expiry.month) + "-" + to_string(_expiry.day)),
-		notional(_notional), optType(_optType), strike(_strike), expiryDate(_expiry), underlying(_underlying) {
+		: TreeProduct(_trade_id, "EU_" + to_string(_strike) + "_" + to_string(_optType) + "_" + _underlying + "_" + to_string(_expiry.getYear()) + "-" + to_string(_expiry.getMonth()) + "-" + to_string(_expiry.getDay())),
+		notional(_notional), optType(_optType), strike(_strike), expiryDate(_expiry) {
+		underlying = _underlying;
 	};
 
 	// for trade factory
@@ -52,9 +53,9 @@ public:
 			"_EU_" + to_string(strike) + "_" +
 			to_string(optType) + "_" +
 			underlying + "_" +
-			to_string(expiryDate.year) + "-" +
-			to_string(expiryDate.month) + "-" +
-			to_string(expiryDate.day);
+			to_string(expiryDate.getYear()) + "-" +
+			to_string(expiryDate.getMonth()) + "-" +
+			to_string(expiryDate.getDay());
 	}
 	inline void updateTreeProductTradeName() {
 		updateName(tradeName);
@@ -67,6 +68,13 @@ public:
 	inline string getCurvename() const override{ return curvename; }
 	inline string getVolname() const override { return volname; }
 	inline string getDirection() const override { return direction; }
+	inline double getStrike() const { return strike; }
+	inline OptionType getOptionType() const { return optType; }
+	inline void hashTerms(HASH::Hasher& h) const override {
+		TreeProduct::hashTerms(h);
+		h.add(strike);
+		h.add(int(optType));
+	}
 
 	//pricing
 	virtual double Payoff(double S) const 
@@ -74,16 +82,19 @@ public:
 		return PAYOFF::VanillaOption(optType, strike, S); 
 	}
 	virtual double ValueAtNode(double S, double t, double continuation) const { return continuation; }
+	bool latticePrice(LATTICE::Model model, const TreeInputs& in, int nSteps, double* states, double* spots, double& value, LATTICE::Greeks* greeks) const override
+	{
+		value = LATTICE::priceVanilla<LATTICE::European>(model, optType, strike, in, nSteps, states, spots, greeks);
+		return true;
+	}
 
 protected:
-	string trade_id;
 	string tradeName;
 	OptionType optType;
 	double strike;
 	string curvename;
 	string volname;
 	Date expiryDate;
-	string underlying;
 	double notional;
 	string direction;
 };
@@ -91,7 +102,7 @@ protected:
 class EuroCallSpread : public EuropeanOption {
 public:
 	EuroCallSpread(const string& _trade_id, double _notional, double _k1, double _k2, const Date& _expiry, const string& _underlying)
-		: EuropeanOption(_trade_id, "EU_Call_Spread_" + to_string(_k1) + "_" + to_string(_k2) + "_" + _underlying + "_" + to_string(_expiry.year) + "-" + to_string(_expiry.month) + "-" + to_string(_expiry.day)), strike1(_k1), strike2(_k2) {
+		: EuropeanOption(_trade_id, "EU_Call_Spread_" + to_string(_k1) + "_" + to_string(_k2) + "_" + _underlying + "_" + to_string(_expiry.getYear()) + "-" + to_string(_expiry.getMonth()) + "-" + to_string(_expiry.getDay())), strike1(_k1), strike2(_k2) {
 		notional = _notional;
 		expiryDate = _expiry;
 		assert(_k1 < _k2);
@@ -101,16 +112,24 @@ public:
 	{ 
 		return PAYOFF::CallSpread(strike1, strike2, S); 
 	};
+	bool latticePrice(LATTICE::Model model, const TreeInputs& in, int nSteps, double* states, double* spots, double& value, LATTICE::Greeks* greeks) const override
+	{
+		value = LATTICE::price<LATTICE::CallSpread, LATTICE::European>(model, in, nSteps, LATTICE::CallSpread{ strike1, strike2 }, states, spots, greeks);
+		return true;
+	}
 	virtual const Date& GetExpiry() const { return expiryDate; };
 	inline string getUnderlying() const override { return underlying; }
 	inline double getNotional() const override { return notional; }
 	inline string getDirection() const override { return direction; }
+	inline void hashTerms(HASH::Hasher& h) const override {
+		TreeProduct::hashTerms(h);
+		h.add(strike1);
+		h.add(strike2);
+	}
 
 private:
-	string trade_id;
 	double strike1;
 	double strike2;
-	double notional;
 	//Date expiryDate;
 };
 
@@ -0,0 +1,53 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "Date.h"
+
+using namespace std;
+
+namespace HASH
+{
+	// 64 bit FNV-1a over the bytes fed in, stable across runs and builds on the same platform.
+	// doubles go in bit for bit, so the hash changes with any change in value.
+	class Hasher
+	{
+	public:
+		inline void add(const void* data, size_t n) {
+			const unsigned char* p = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < n; ++i) {
+				h ^= p[i];
+				h *= 1099511628211ull;
+			}
+		}
+		inline void add(double x) { add(&x, sizeof(x)); }
+		inline void add(int64_t x) { add(&x, sizeof(x)); }
+		inline void add(uint64_t x) { add(&x, sizeof(x)); }
+		inline void add(int x) { add(int64_t(x)); }
+		inline void add(bool x) { add(int64_t(x)); }
+		inline void add(const Date& d) { add(int64_t(d.serialDay())); }
+		// length first, "ab" + "c" and "a" + "bc" differ
+		inline void add(const string& s) {
+			add(uint64_t(s.size()));
+			add(s.data(), s.size());
+		}
+		inline void add(const char* s) { add(string(s)); }
+		template <typename T>
+		inline void add(const vector<T>& v) {
+			add(uint64_t(v.size()));
+			for (const auto& x : v)
+				add(x);
+		}
+
+		inline uint64_t value() const { return h; }
+
+	private:
+		uint64_t h = 14695981039346656037ull;
+	};
+}
+
+#endif
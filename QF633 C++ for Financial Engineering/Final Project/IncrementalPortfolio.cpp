@@ -0,0 +1,126 @@
+#include <cmath>
+
+#include "IncrementalPortfolio.h"
+#include "Pricer.h"
+
+IncrementalPortfolio::IncrementalPortfolio(const Market& mkt, double curve_shock, double vol_shock, int nSteps)
+	: market(mkt), curveShock(curve_shock), volShock(vol_shock), treeSteps(nSteps)
+{
+	buildShocks();
+}
+
+void IncrementalPortfolio::buildShocks()
+{
+	curveShocks.clear();
+	volShocks.clear();
+	for (const auto& name : market.getCurveNames()) {
+		BumpedCurve bumped{ market.withShockedCurve(name, Date(), curveShock), market.withShockedCurve(name, Date(), -curveShock) };
+		curveShocks.emplace(name, std::move(bumped));
+	}
+	for (const auto& name : market.getVolNames())
+		volShocks.emplace(name, market.withShockedVolCurve(name, Date(), volShock));
+}
+
+TradeRisk IncrementalPortfolio::evaluate(const shared_ptr<Trade>& trade) const
+{
+	// same measures as RiskEngine::computeRisk, but only the factors this trade depends on
+	CRRBinomialTreePricer pricer(treeSteps);
+	auto price = [&](const Market& mkt) {
+		return trade->getType() == "TreeProduct" ? pricer.Price(mkt, trade) : trade->Pv(mkt);
+	};
+
+	TradeRisk risk;
+	risk.pv = price(market);
+
+	auto curve = curveShocks.find(trade->getCurvename());
+	if (curve != curveShocks.end()) {
+		risk.curve = curve->first;
+		risk.dv01 = (price(curve->second.up) - price(curve->second.down)) / 2.0;
+	}
+	auto vol = volShocks.find(trade->getVolname());
+	if (vol != volShocks.end()) {
+		risk.vol = vol->first;
+		risk.vega = price(vol->second) - risk.pv;
+	}
+	return risk;
+}
+
+void IncrementalPortfolio::apply(const TradeRisk& risk, double sign)
+{
+	// a value that does not price would poison the totals for good, it is counted instead
+	bool priced = std::isfinite(risk.pv) && std::isfinite(risk.dv01) && std::isfinite(risk.vega);
+	if (!priced) {
+		sign > 0 ? ++unpriced : --unpriced;
+		return;
+	}
+	pv += sign * risk.pv;
+	if (!risk.curve.empty())
+		dv01[risk.curve] += sign * risk.dv01;
+	if (!risk.vol.empty())
+		vega[risk.vol] += sign * risk.vega;
+}
+
+bool IncrementalPortfolio::add(const shared_ptr<Trade>& trade)
+{
+	const string& id = trade->getTradeid();
+	if (book.count(id))
+		return false;
+
+	trade->compile(market);
+	TradeRisk risk = evaluate(trade);
+	apply(risk, 1.0);
+	book.emplace(id, make_pair(trade, std::move(risk)));
+	return true;
+}
+
+bool IncrementalPortfolio::amend(const shared_ptr<Trade>& trade)
+{
+	auto it = book.find(trade->getTradeid());
+	if (it == book.end())
+		return false;
+
+	trade->compile(market);
+	TradeRisk risk = evaluate(trade);
+	apply(it->second.second, -1.0);
+	apply(risk, 1.0);
+	it->second = make_pair(trade, std::move(risk));
+	return true;
+}
+
+bool IncrementalPortfolio::cancel(const string& tradeId)
+{
+	auto it = book.find(tradeId);
+	if (it == book.end())
+		return false;
+
+	apply(it->second.second, -1.0);
+	book.erase(it);
+	return true;
+}
+
+void IncrementalPortfolio::rebase(const Market& mkt)
+{
+	market = mkt;
+	buildShocks();
+	for (auto& kv : book) {
+		kv.second.first->compile(market);
+		kv.second.second = evaluate(kv.second.first);
+	}
+	resum();
+}
+
+void IncrementalPortfolio::resum()
+{
+	pv = 0;
+	dv01.clear();
+	vega.clear();
+	unpriced = 0;
+	for (const auto& kv : book)
+		apply(kv.second.second, 1.0);
+}
+
+const TradeRisk* IncrementalPortfolio::getTradeRisk(const string& tradeId) const
+{
+	auto it = book.find(tradeId);
+	return it == book.end() ? nullptr : &it->second.second;
+}
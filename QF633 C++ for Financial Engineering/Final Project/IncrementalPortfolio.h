@@ -0,0 +1,77 @@
+#ifndef INCREMENTAL_PORTFOLIO_H
+#define INCREMENTAL_PORTFOLIO_H
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+#include "Trade.h"
+#include "Market.h"
+
+using namespace std;
+
+// what one trade adds to the book
+struct TradeRisk {
+	double pv = 0;
+	string curve;      // dv01 is against the trade's own curve, empty when it has none
+	double dv01 = 0;
+	string vol;        // vega against the trade's own vol curve, empty when it has none
+	double vega = 0;
+};
+
+// Book that takes intraday trade events. Booking, amending or cancelling a trade prices that
+// trade alone (pv, a parallel bump of its curve and of its vol curve) and moves the firm-wide
+// aggregates by the difference, the rest of the book is not touched.
+//
+// Bumped markets are built once per curve and vol curve. Values that do not price (e.g. an
+// expired option) are kept per trade but left out of the aggregates and counted instead.
+// Not thread safe, events are expected from one thread.
+class IncrementalPortfolio
+{
+public:
+	IncrementalPortfolio(const Market& mkt, double curveShock, double volShock, int treeSteps = 50);
+
+	// false when the id is already booked
+	bool add(const shared_ptr<Trade>& trade);
+	// replaces the trade with the same id, false when there is none
+	bool amend(const shared_ptr<Trade>& trade);
+	// false when the id is not booked
+	bool cancel(const string& tradeId);
+
+	// new market, every trade is repriced and the aggregates rebuilt
+	void rebase(const Market& mkt);
+	// re-adds the aggregates from the per trade risk, clears any rounding drift
+	void resum();
+
+	inline double getPv() const { return pv; }
+	inline const unordered_map<string, double>& getDv01() const { return dv01; }
+	inline const unordered_map<string, double>& getVega() const { return vega; }
+	inline size_t getUnpriced() const { return unpriced; }
+	inline size_t size() const { return book.size(); }
+	const TradeRisk* getTradeRisk(const string& tradeId) const;
+
+private:
+	struct BumpedCurve {
+		Market up;
+		Market down;
+	};
+
+	TradeRisk evaluate(const shared_ptr<Trade>& trade) const;
+	void apply(const TradeRisk& risk, double sign);
+	void buildShocks();
+
+	Market market;
+	double curveShock;
+	double volShock;
+	int treeSteps;
+	unordered_map<string, BumpedCurve> curveShocks;
+	unordered_map<string, Market> volShocks;
+
+	unordered_map<string, pair<shared_ptr<Trade>, TradeRisk>> book;
+	double pv = 0;
+	unordered_map<string, double> dv01;
+	unordered_map<string, double> vega;
+	size_t unpriced = 0;
+};
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef INTERPOLATION_H
+#define INTERPOLATION_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+enum InterpolationType
+{
+	LinearZero,     // linear in zero rate
+	LogLinearDf,    // linear in log discount factor, zero rate extrapolated flat
+	MonotoneCubic,  // Hyman filtered cubic hermite in zero rate
+	FlatForward     // piecewise flat instantaneous forward, last forward extrapolated
+};
+
+// cubic on one pillar segment, g(t) = a + b*s + c*s^2 + d*s^3 with s = t - t_i
+struct Segment {
+	double a = 0;
+	double b = 0;
+	double c = 0;
+	double d = 0;
+
+	inline double operator()(double s) const { return a + s * (b + s * (c + s * d)); }
+};
+
+// Interpolation policies. Each one turns the pillars (t_i, y_i) into per-segment polynomial
+// coefficients once, at build time. onRateTime tells whether the polynomial is in y*t
+// (i.e. -log df) space rather than in y space; that is the only thing a lookup depends on.
+// reach is how many pillars either side a single pillar's value feeds into.
+namespace INTERP
+{
+	struct LinearZero
+	{
+		static constexpr bool onRateTime = false;
+		static constexpr int reach = 1;
+
+		static void build(const vector<double>& t, const vector<double>& y, vector<Segment>& segs, Segment& tail)
+		{
+			for (size_t i = 0; i + 1 < t.size(); ++i) {
+				segs[i].a = y[i];
+				segs[i].b = (y[i + 1] - y[i]) / (t[i + 1] - t[i]);
+			}
+			tail.a = y.back();
+		}
+	};
+
+	struct LogLinearDf
+	{
+		static constexpr bool onRateTime = true;
+		static constexpr int reach = 1;
+
+		static void build(const vector<double>& t, const vector<double>& y, vector<Segment>& segs, Segment& tail)
+		{
+			for (size_t i = 0; i + 1 < t.size(); ++i) {
+				segs[i].a = y[i] * t[i];
+				segs[i].b = (y[i + 1] * t[i + 1] - y[i] * t[i]) / (t[i + 1] - t[i]);
+			}
+			// flat zero rate beyond the last pillar
+			tail.a = y.back() * t.back();
+			tail.b = y.back();
+		}
+	};
+
+	struct FlatForward
+	{
+		static constexpr bool onRateTime = true;
+		static constexpr int reach = 1;
+
+		static void build(const vector<double>& t, const vector<double>& y, vector<Segment>& segs, Segment& tail)
+		{
+			LogLinearDf::build(t, y, segs, tail);
+			// keep the last forward beyond the last pillar
+			if (t.size() > 1)
+				tail.b = segs[t.size() - 2].b;
+		}
+	};
+
+	struct MonotoneCubic
+	{
+		static constexpr bool onRateTime = false;
+		static constexpr int reach = 2; // bessel slopes use the neighbouring segments
+
+		static void build(const vector<double>& t, const vector<double>& y, vector<Segment>& segs, Segment& tail)
+		{
+			size_t n = t.size();
+			tail.a = y.back();
+			if (n < 3) {
+				LinearZero::build(t, y, segs, tail);
+				return;
+			}
+
+			vector<double> h(n - 1), delta(n - 1), m(n);
+			for (size_t i = 0; i + 1 < n; ++i) {
+				h[i] = t[i + 1] - t[i];
+				delta[i] = (y[i + 1] - y[i]) / h[i];
+			}
+
+			// bessel slopes, one sided at the ends
+			m[0] = delta[0];
+			m[n - 1] = delta[n - 2];
+			for (size_t i = 1; i + 1 < n; ++i) {
+				m[i] = (h[i] * delta[i - 1] + h[i - 1] * delta[i]) / (h[i - 1] + h[i]);
+			}
+
+			// hyman filter, keeps the interpolant monotone wherever the pillars are
+			for (size_t i = 0; i < n; ++i) {
+				double dl = i > 0 ? delta[i - 1] : delta[0];
+				double dr = i + 1 < n ? delta[i] : delta[n - 2];
+				if (dl * dr <= 0) {
+					m[i] = 0;
+				}
+				else {
+					double bound = 3 * std::min(std::fabs(dl), std::fabs(dr));
+					if (std::fabs(m[i]) > bound)
+						m[i] = m[i] > 0 ? bound : -bound;
+				}
+			}
+
+			for (size_t i = 0; i + 1 < n; ++i) {
+				segs[i].a = y[i];
+				segs[i].b = m[i];
+				segs[i].c = (3 * delta[i] - 2 * m[i] - m[i + 1]) / h[i];
+				segs[i].d = (m[i] + m[i + 1] - 2 * delta[i]) / (h[i] * h[i]);
+			}
+		}
+	};
+}
+
+// Pillar times in years, sorted, with the segment polynomials of the chosen policy.
+// Values before the first pillar are extrapolated flat.
+class InterpolatedCurve
+{
+public:
+	template <class Interp>
+	void build(const vector<double>& t, const vector<double>& y)
+	{
+		if (t.empty() || t.size() != y.size())
+			throw std::runtime_error("Error: invalid pillars for interpolation");
+
+		times = t;
+		front = y.front();
+		segs.assign(t.size(), Segment());
+		Segment tail;
+		Interp::build(t, y, segs, tail);
+		segs.back() = tail;
+		onRateTime = Interp::onRateTime;
+		reach = Interp::reach;
+	}
+
+	// compiled form as it is, for the binary market snapshot
+	void restore(const double* t, const Segment* s, size_t n, double _front, bool _onRateTime, int _reach)
+	{
+		if (n == 0)
+			throw std::runtime_error("Error: invalid pillars for interpolation");
+		times.assign(t, t + n);
+		segs.assign(s, s + n);
+		front = _front;
+		onRateTime = _onRateTime;
+		reach = _reach;
+	}
+	inline const vector<Segment>& getSegments() const { return segs; }
+	inline double getFront() const { return front; }
+	inline bool isOnRateTime() const { return onRateTime; }
+	inline int getReach() const { return reach; }
+
+	inline bool empty() const { return times.empty(); }
+	inline void clear() { times.clear(); segs.clear(); }
+	inline const vector<double>& getTimes() const { return times; }
+
+	// open interval of times whose value can move when pillar i is bumped. The front flat
+	// extrapolation only follows pillar 0; the back is left open whenever the pillar feeds
+	// the last segment, which covers the flat forward tail.
+	inline pair<double, double> bumpSupport(size_t i) const
+	{
+		double lo = i == 0 ? -HUGE_VAL : times[i >= size_t(reach) ? i - reach : 0];
+		double hi = i + reach >= times.size() - 1 ? HUGE_VAL : times[i + reach];
+		return make_pair(lo, hi);
+	}
+
+	// y(t)
+	inline double value(double t) const
+	{
+		if (t <= times.front())
+			return front;
+		size_t i = segment(t);
+		double g = segs[i](t - times[i]);
+		return onRateTime ? g / t : g;
+	}
+
+	// y(t) * t, which for a zero curve is -log df(t)
+	inline double valueTimesT(double t) const
+	{
+		if (t <= times.front())
+			return front * t;
+		size_t i = segment(t);
+		double g = segs[i](t - times[i]);
+		return onRateTime ? g : g * t;
+	}
+
+private:
+	// index of the last pillar at or before t (t > times.front())
+	inline size_t segment(double t) const
+	{
+		return std::upper_bound(times.begin(), times.end(), t) - times.begin() - 1;
+	}
+
+	vector<double> times;
+	vector<Segment> segs; // segs[i] covers [t_i, t_i+1), the last one is the tail beyond t_n
+	double front = 0;
+	bool onRateTime = false;
+	int reach = 1;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include <thread>
+#include <functional>
+
+#include "LiveMarket.h"
+
+LiveMarket::LiveMarket(const Market& initial, size_t maxReaders)
+	: current(new Market(initial)), slots(new Slot[maxReaders > 0 ? maxReaders : 1]), nSlots(maxReaders > 0 ? maxReaders : 1)
+{
+}
+
+LiveMarket::~LiveMarket()
+{
+	// no reader can be pinned once the owner is destroyed
+	for (auto& r : retired)
+		delete r.snapshot;
+	delete current.load();
+}
+
+LiveMarket::Reader LiveMarket::pin() const
+{
+	// start from a slot picked by thread id so concurrent readers rarely collide
+	size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % nSlots;
+	for (;;) {
+		for (size_t k = 0; k < nSlots; ++k) {
+			auto& slot = slots[(start + k) % nSlots].pinned;
+			unsigned long long expected = 0;
+			// announce the epoch before reading the pointer. a writer that frees a snapshot has
+			// swapped it out before bumping the epoch, so a reader that enters the new epoch can
+			// only load the new pointer. both steps are seq_cst to keep that order with the
+			// writer's scan of the slots.
+			if (slot.compare_exchange_strong(expected, epoch.load()))
+				return Reader(&slot, current.load());
+		}
+		// more readers than slots, wait for one to leave
+		std::this_thread::yield();
+	}
+}
+
+void LiveMarket::publish(const Market& next)
+{
+	// the copy is cheap, curves and price tables are shared
+	const Market* snapshot = new Market(next);
+	lock_guard<mutex> lock(writerMutex);
+	publishLocked(snapshot);
+}
+
+void LiveMarket::update(const function<Market(const Market&)>& change)
+{
+	// read-modify-write, the change sees the latest published snapshot
+	lock_guard<mutex> lock(writerMutex);
+	const Market* snapshot = new Market(change(*current.load()));
+	publishLocked(snapshot);
+}
+
+void LiveMarket::updateCurve(const string& name, shared_ptr<const RateCurve> curve)
+{
+	update([&](const Market& mkt) { return mkt.withCurve(name, curve); });
+}
+
+void LiveMarket::updateStockPrice(const string& name, double price)
+{
+	update([&](const Market& mkt) { return mkt.withStockPrice(name, price); });
+}
+
+size_t LiveMarket::reclaim()
+{
+	lock_guard<mutex> lock(writerMutex);
+	return reclaimLocked();
+}
+
+void LiveMarket::publishLocked(const Market* next)
+{
+	const Market* old = current.exchange(next);
+	unsigned long long retiredAt = epoch.fetch_add(1) + 1;
+	retired.push_back(Retired{ old, retiredAt });
+	// freeing happens here on the writer, readers never pay for it
+	reclaimLocked();
+}
+
+size_t LiveMarket::reclaimLocked()
+{
+	// oldest epoch any reader is still in
+	unsigned long long oldest = epoch.load();
+	for (size_t i = 0; i < nSlots; ++i) {
+		unsigned long long e = slots[i].pinned.load();
+		if (e != 0 && e < oldest)
+			oldest = e;
+	}
+
+	size_t kept = 0;
+	for (auto& r : retired) {
+		// a reader in an epoch before retirement may still hold the snapshot
+		if (r.epoch <= oldest)
+			delete r.snapshot;
+		else
+			retired[kept++] = r;
+	}
+	retired.resize(kept);
+	return kept;
+}
@@ -0,0 +1,91 @@
+#ifndef LIVE_MARKET_H
+#define LIVE_MARKET_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "Market.h"
+
+using namespace std;
+
+// Market that can be updated while it is being priced (read-copy-update).
+//
+// Readers pin the current epoch and get the current snapshot, with no lock and no reference
+// count. Writers build a new snapshot next to the live one, swap it in atomically and retire
+// the old one. A retired snapshot is freed once every reader that could still see it has
+// unpinned, so a pricing task keeps one consistent market for its whole life and never waits
+// on a writer.
+//
+// New snapshots should be derived from the current one (withCurve, withStockPrice, ...) so that
+// trade handles resolved against the first market stay valid.
+class LiveMarket
+{
+public:
+	// slot table size, i.e. how many readers can be pinned at the same time
+	explicit LiveMarket(const Market& initial, size_t maxReaders = 256);
+	~LiveMarket();
+
+	LiveMarket(const LiveMarket&) = delete;
+	LiveMarket& operator=(const LiveMarket&) = delete;
+
+	// pinned view of the current snapshot, unpins when it goes out of scope
+	class Reader
+	{
+	public:
+		Reader(Reader&& other) noexcept : slot(other.slot), snapshot(other.snapshot) { other.slot = nullptr; }
+		~Reader() { if (slot) slot->store(0, std::memory_order_release); }
+
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+
+		inline const Market& market() const { return *snapshot; }
+		inline const Market* operator->() const { return snapshot; }
+
+	private:
+		friend class LiveMarket;
+		Reader(std::atomic<unsigned long long>* _slot, const Market* _snapshot) : slot(_slot), snapshot(_snapshot) {};
+
+		std::atomic<unsigned long long>* slot;
+		const Market* snapshot;
+	};
+
+	Reader pin() const;
+
+	// writer side, writers are serialised among themselves but never block readers
+	void publish(const Market& next);
+	void update(const function<Market(const Market&)>& change);
+	void updateCurve(const string& name, shared_ptr<const RateCurve> curve);
+	void updateStockPrice(const string& name, double price);
+
+	// frees the retired snapshots no reader can see any more, returns how many are still held
+	size_t reclaim();
+
+	inline unsigned long long getEpoch() const { return epoch.load(); }
+
+private:
+	// one cache line per slot so pinning readers don't share lines
+	struct alignas(64) Slot {
+		std::atomic<unsigned long long> pinned{ 0 }; // 0 when free, else the epoch the reader entered
+	};
+
+	struct Retired {
+		const Market* snapshot;
+		unsigned long long epoch; // first epoch in which the snapshot is no longer reachable
+	};
+
+	void publishLocked(const Market* next);
+	size_t reclaimLocked();
+
+	std::atomic<const Market*> current;
+	std::atomic<unsigned long long> epoch{ 1 };
+	unique_ptr<Slot[]> slots;
+	size_t nSlots;
+
+	mutex writerMutex;
+	vector<Retired> retired;
+};
+
+#endif
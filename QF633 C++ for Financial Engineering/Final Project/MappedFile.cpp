@@ -0,0 +1,90 @@
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const string& filename)
+{
+	HANDLE f = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (f == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Error opening file " + filename);
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(f, &fileSize)) {
+		CloseHandle(f);
+		throw std::runtime_error("Error reading size of " + filename);
+	}
+	file = f;
+	length = static_cast<size_t>(fileSize.QuadPart);
+	if (length == 0)
+		return; // nothing to map, data() stays null
+
+	HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m == NULL) {
+		CloseHandle(f);
+		throw std::runtime_error("Error mapping file " + filename);
+	}
+	mapping = m;
+	base = static_cast<const char*>(MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0));
+	if (base == nullptr) {
+		CloseHandle(m);
+		CloseHandle(f);
+		throw std::runtime_error("Error mapping file " + filename);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (base)
+		UnmapViewOfFile(base);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+}
+
+#else
+
+MappedFile::MappedFile(const string& filename)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Error opening file " + filename);
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		throw std::runtime_error("Error reading size of " + filename);
+	}
+	length = static_cast<size_t>(st.st_size);
+	if (length > 0) {
+		void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			::close(fd);
+			throw std::runtime_error("Error mapping file " + filename);
+		}
+		base = static_cast<const char*>(p);
+	}
+	// the mapping keeps the file alive
+	::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (base)
+		::munmap(const_cast<char*>(base), length);
+}
+
+#endif
@@ -1,4 +1,7 @@
+#include <cmath>
+#include <atomic>
 #include "Market.h"
+#include "SimdMath.h"
 
 using namespace std;
 
@@ -11,44 +14,55 @@ void RateCurve::display() const {
 }
 
 void RateCurve::addRate(Date tenor, double rate) {
-	//check if tenor already exist
-	auto exists = std::find(tenorDates.begin(), tenorDates.end(), tenor);
+	//keep pillars sorted, ignore a tenor that already exists
+	auto pos = std::lower_bound(tenorDates.begin(), tenorDates.end(), tenor);
 
-	if (exists == tenorDates.end()) {
-		tenorDates.push_back(tenor);
-		rates.push_back(rate);
+	if (pos == tenorDates.end() || *pos != tenor) {
+		rates.insert(rates.begin() + (pos - tenorDates.begin()), rate);
+		tenorDates.insert(pos, tenor);
+		curve.clear(); // needs recompiling
 	}
 }
 
-double RateCurve::getRate(Date tenor) const {
-	//check if exact date exists, if not, linearly interpolate
-	auto exists = std::find(tenorDates.begin(), tenorDates.end(), tenor);
-	if (tenor - tenorDates[0] < 0) {
-		return rates[0];
-	}
-	else if (tenor - tenorDates[tenorDates.size() - 1] > 0) {
-		return rates[tenorDates.size() - 1];
-	}
-	else if (exists != tenorDates.end()) {
-		size_t index = std::distance(tenorDates.begin(), exists);
-		return rates[index];
-	}
-	//use linear interpolation to get rate
-	else {
-		for (size_t i = 0; i < tenorDates.size() - 1; ++i) {
-			if (tenor - tenorDates[i] >= 0 && tenorDates[i + 1] - tenor >= 0) {
+void RateCurve::setInterpolation(InterpolationType type) {
+	interpolation = type;
+	if (isCompiled())
+		compile(anchor);
+}
 
-				Date x0 = tenorDates[i];
-				Date x1 = tenorDates[i + 1];
-				double y0 = rates[i];
-				double y1 = rates[i + 1];
+void RateCurve::compile(const Date& _anchor) {
+	if (tenorDates.empty())
+		throw std::runtime_error("Error: cannot compile empty rate curve " + name);
 
-				return y0 + (tenor - x0) * (y1 - y0) / (x1 - x0);
-			}
-		}
+	anchor = _anchor;
+	vector<double> times(tenorDates.size());
+	for (size_t i = 0; i < tenorDates.size(); ++i) {
+		times[i] = yearFraction(anchor, tenorDates[i]);
+	}
+
+	switch (interpolation)
+	{
+	case LinearZero:
+		curve.build<INTERP::LinearZero>(times, rates);
+		break;
+	case LogLinearDf:
+		curve.build<INTERP::LogLinearDf>(times, rates);
+		break;
+	case MonotoneCubic:
+		curve.build<INTERP::MonotoneCubic>(times, rates);
+		break;
+	case FlatForward:
+		curve.build<INTERP::FlatForward>(times, rates);
+		break;
+	default:
+		throw std::runtime_error("Error: unsupported interpolation for rate curve " + name);
 	}
 }
 
+double RateCurve::getRate(Date tenor) const {
+	return getRate(yearFraction(anchor, tenor));
+}
+
 double RateCurve::getDf(Date _date, Date valueDate) const
 {
 	double ccr = getRate(_date);
@@ -56,12 +70,33 @@ double RateCurve::getDf(Date _date, Date valueDate) const
 	return exp(-ccr * t);
 }
 
+void RateCurve::getDf(const double* t, double* df, size_t n) const
+{
+	checkCompiled();
+	// interpolate the exponents first, then take exp over the whole batch in one vectorised pass
+	for (size_t i = 0; i < n; ++i) {
+		df[i] = -curve.valueTimesT(t[i]);
+	}
+	SIMD::exp(df, df, n);
+}
+
 void RateCurve::shock(Date tenor, double value)
 {
-	// parallel shock all tenors rate
-	for (auto& rt : rates) {
-		rt += value;
+	if (tenor == Date()) {
+		// parallel shock all tenors rate
+		for (auto& rt : rates) {
+			rt += value;
+		}
+	}
+	else {
+		// key rate shock on a single pillar
+		auto pos = std::lower_bound(tenorDates.begin(), tenorDates.end(), tenor);
+		if (pos == tenorDates.end() || *pos != tenor)
+			throw std::runtime_error("Error: no pillar to shock on rate curve " + name);
+		rates[pos - tenorDates.begin()] += value;
 	}
+	if (isCompiled())
+		compile(anchor);
 }
 
 void VolCurve::display() const {
@@ -73,13 +108,26 @@ void VolCurve::display() const {
 }
 
 void VolCurve::addVol(Date tenor, double rate) {
-	//check if tenor already exist
-	auto exists = std::find(tenors.begin(), tenors.end(), tenor);
+	//keep pillars sorted, ignore a tenor that already exists
+	auto pos = std::lower_bound(tenors.begin(), tenors.end(), tenor);
+
+	if (pos == tenors.end() || *pos != tenor) {
+		vols.insert(vols.begin() + (pos - tenors.begin()), rate);
+		tenors.insert(pos, tenor);
+		curve.clear(); // needs recompiling
+	}
+}
 
-	if (exists == tenors.end()) {
-		tenors.push_back(tenor);
-		vols.push_back(rate);
+void VolCurve::compile(const Date& _anchor) {
+	if (tenors.empty())
+		throw std::runtime_error("Error: cannot compile empty vol curve " + name);
+
+	anchor = _anchor;
+	vector<double> times(tenors.size());
+	for (size_t i = 0; i < tenors.size(); ++i) {
+		times[i] = yearFraction(anchor, tenors[i]);
 	}
+	curve.build<INTERP::LinearZero>(times, vols);
 }
 
 void VolCurve::shock(Date tenor, double value)
@@ -88,76 +136,159 @@ void VolCurve::shock(Date tenor, double value)
 	for (auto& v : vols) {
 		v += value;
 	}
+	if (isCompiled())
+		compile(anchor);
 }
 
 double VolCurve::getVol(Date tenor) const {
-	//check if exact date exists, if not, linearly interpolate
-	auto exists = std::find(tenors.begin(), tenors.end(), tenor);
-	if (tenor - tenors[0] < 0) {
-		return vols[0];
-	}
-	else if (tenor - tenors[tenors.size() - 1] > 0) {
-		return vols[tenors.size() - 1];
-	}
-	if (exists != tenors.end()) {
-		size_t index = std::distance(tenors.begin(), exists);
-		return vols[index];
-	}
-	//use linear interpolation to get rate
-	else {
-		for (size_t i = 0; i < tenors.size() - 1; ++i) {
-			if (tenor - tenors[i] >= 0 && tenors[i + 1] - tenor >= 0) {
-
-				Date x0 = tenors[i];
-				Date x1 = tenors[i + 1];
-				double y0 = vols[i];
-				double y1 = vols[i + 1];
-
-				return y0 + (tenor - x0) * (y1 - y0) / (x1 - x0);
-			}
-		}
-	}
+	return getVol(yearFraction(anchor, tenor));
 }
 
 void Market::Print() const
 {
 	cout << "market asof: " << asOf << endl;
 
-	for (auto curve : curves) {
-		curve.second->display();
+	for (size_t i = 0; i < curves.size(); ++i) {
+		curves[i]->display();
 	}
-	for (auto vol : vols) {
-		vol.second->display();
+	for (size_t i = 0; i < vols.size(); ++i) {
+		vols[i]->display();
 	}
 
 	cout << "Bond Price:" << endl;
-	for (auto bondPrice : bondPrices) {
-		cout << bondPrice.first << ' ' << bondPrice.second << endl;
+	for (size_t i = 0; i < registry->bonds.size(); ++i) {
+		cout << registry->bonds.getNames()[i] << ' ' << bondPrices[i] << endl;
 
 	}
 	cout << endl;
 
 	cout << "Stock Price:" << endl;
-	for (auto stockPrice : stockPrices) {
-		cout << stockPrice.first << ' ' << stockPrice.second << endl;
+	for (size_t i = 0; i < registry->stocks.size(); ++i) {
+		cout << registry->stocks.getNames()[i] << ' ' << stockPrices[i] << endl;
 	}
 }
 
+vector<string> Market::getCurveNames() const
+{
+	vector<string> names = registry->curves.getNames();
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+vector<string> Market::getVolNames() const
+{
+	vector<string> names = registry->vols.getNames();
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+MarketRegistry& Market::editRegistry()
+{
+	// the registry is shared with derived snapshots, copy it before adding names unless this
+	// market is the only owner. existing ids never change so handles resolved earlier stay valid.
+	if (registry.use_count() != 1)
+		registry = make_shared<MarketRegistry>(*registry);
+	return *registry;
+}
+
 void Market::addCurve(const std::string& name, shared_ptr<RateCurve> curve) 
 {
-	curves.emplace(name, curve);
+	if (registry->curves.find(name) >= 0)
+		return;
+	// curves are compiled against the market date once they are loaded
+	curve->compile(asOf);
+	editRegistry().curves.add(name);
+	curves.push_back(curve);
+	version = nextVersion();
 }
 void Market::addVolCurve(const std::string& name, shared_ptr<VolCurve> vol)
 {
-	vols.emplace(name, vol);
+	if (registry->vols.find(name) >= 0)
+		return;
+	vol->compile(asOf);
+	editRegistry().vols.add(name);
+	vols.push_back(vol);
+	version = nextVersion();
 }
 
 void Market::addBondPrice(const std::string& bondName, double price) {
-	bondPrices.emplace(bondName, price);
+	if (registry->bonds.find(bondName) >= 0)
+		return;
+	editRegistry().bonds.add(bondName);
+	bondPrices.push_back(price);
+	version = nextVersion();
 }
 
 void Market::addStockPrice(const std::string& stockName, double price) {
-	stockPrices.emplace(stockName, price);
+	if (registry->stocks.find(stockName) >= 0)
+		return;
+	editRegistry().stocks.add(stockName);
+	stockPrices.push_back(price);
+	version = nextVersion();
+}
+
+Market Market::withCurve(const string& name, shared_ptr<const RateCurve> curve) const
+{
+	Market mkt(*this);
+	mkt.curves.set(registry->curves.at(name), curve);
+	mkt.version = nextVersion();
+	return mkt;
+}
+
+Market Market::withVolCurve(const string& name, shared_ptr<const VolCurve> vol) const
+{
+	Market mkt(*this);
+	mkt.vols.set(registry->vols.at(name), vol);
+	mkt.version = nextVersion();
+	return mkt;
+}
+
+Market Market::withShockedCurve(const string& name, const Date& tenor, double shock) const
+{
+	auto curve = make_shared<RateCurve>(*getCurve(name));
+	curve->shock(tenor, shock);
+	return withCurve(name, curve);
+}
+
+Market Market::withShockedVolCurve(const string& name, const Date& tenor, double shock) const
+{
+	auto vol = make_shared<VolCurve>(*getVolCurve(name));
+	vol->shock(tenor, shock);
+	return withVolCurve(name, vol);
+}
+
+Market Market::withShockedPrice(const string& underlying, double shock) const
+{
+	Market mkt(*this);
+	int id = mkt.stockSlot(underlying);
+	mkt.stockPrices.set(id, stockPrices[id] + shock);
+	mkt.version = nextVersion();
+	return mkt;
+}
+
+Market Market::withStockPrice(const string& underlying, double price) const
+{
+	Market mkt(*this);
+	mkt.stockPrices.set(mkt.stockSlot(underlying), price);
+	mkt.version = nextVersion();
+	return mkt;
+}
+
+int Market::stockSlot(const string& underlying)
+{
+	// an unknown underlying is registered with a zero price
+	int id = registry->stocks.find(underlying);
+	if (id < 0) {
+		id = editRegistry().stocks.add(underlying);
+		stockPrices.push_back(0.0);
+	}
+	return id;
+}
+
+unsigned long long Market::nextVersion()
+{
+	static std::atomic<unsigned long long> counter(0);
+	return ++counter;
 }
 
 std::ostream& operator<<(std::ostream& os, const Market& mkt)
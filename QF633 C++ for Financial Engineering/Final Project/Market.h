@@ -4,79 +4,233 @@
 #include <iostream>
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
 #include "Date.h"
+#include "Interpolation.h"
+#include "Hash.h"
 
 using namespace std;
 
+// Pillars are kept sorted by tenor. Once loading is done, compile() turns them into year
+// fractions from the anchor date and precomputes the segment polynomials of the chosen
+// interpolation, so a lookup is a binary search plus a polynomial evaluation.
 class RateCurve {
 public:
 	RateCurve() {};
 	RateCurve(const string& _name) : name(_name) {};
 	void addRate(Date tenor, double rate);
-	double getRate(Date tenor) const; //implement this function using linear interpolation
+	void setInterpolation(InterpolationType type);
+	void compile(const Date& anchor);
+	double getRate(Date tenor) const;
+	inline double getRate(double t) const { checkCompiled(); return curve.value(t); } //t in years (ACT/365F) from the anchor date
 	double getDf(Date _date, Date valueDate) const;
+	// batch discounting: t[i] in years from the anchor date, writes df[i] = exp(-r(t[i]) * t[i])
+	void getDf(const double* t, double* df, size_t n) const;
+	// Date() shifts every pillar in parallel, a pillar date bumps only that pillar (key rate)
 	void shock(Date tenor, double value);
 	void display() const;
 
+	inline bool isCompiled() const { return !curve.empty(); }
+	inline const Date& getAnchor() const { return anchor; }
+	inline InterpolationType getInterpolation() const { return interpolation; }
+	inline const string& getName() const { return name; }
+	inline const vector<Date>& getPillarDates() const { return tenorDates; }
+	// everything a price read off the curve depends on
+	inline void hashContent(HASH::Hasher& h) const {
+		h.add(anchor);
+		h.add(int(interpolation));
+		h.add(tenorDates);
+		h.add(rates);
+	}
+	// times (years from the anchor) where the curve moves when the pillar at index i is bumped
+	inline pair<double, double> getBumpSupport(size_t i) const { checkCompiled(); return curve.bumpSupport(i); }
+
 private:
+	inline void checkCompiled() const {
+		if (!isCompiled())
+			throw std::runtime_error("Error: rate curve " + name + " is not compiled");
+	}
+
+	friend class Market; // binary snapshot
+
 	std::string name;
 	vector<Date> tenorDates;
 	vector<double> rates;
+	InterpolationType interpolation = LinearZero;
+
+	// compiled form
+	Date anchor;
+	InterpolatedCurve curve;
 };
 
-class VolCurve { // atm vol curve without smile
+class VolCurve { // atm vol curve without smile, linear in vol
 public:
 	VolCurve() {}
 	VolCurve(const string& _name) : name(_name) {};
-	void addVol(Date tenor, double rate); //implement this
-	double getVol(Date tenor) const; //implement this function using linear interpolation
+	void addVol(Date tenor, double rate);
+	void compile(const Date& anchor);
+	double getVol(Date tenor) const;
+	inline double getVol(double t) const { checkCompiled(); return curve.value(t); } //t in years (ACT/365F) from the anchor date
 	void shock(Date tenor, double value);
-	void display() const; //implement this
+	void display() const;
+
+	inline bool isCompiled() const { return !curve.empty(); }
+	inline const Date& getAnchor() const { return anchor; }
+	inline void hashContent(HASH::Hasher& h) const {
+		h.add(anchor);
+		h.add(tenors);
+		h.add(vols);
+	}
 
 private:
+	inline void checkCompiled() const {
+		if (!isCompiled())
+			throw std::runtime_error("Error: vol curve " + name + " is not compiled");
+	}
+
+	friend class Market; // binary snapshot
+
 	string name;
 	vector<Date> tenors;
 	vector<double> vols;
+
+	// compiled form
+	Date anchor;
+	InterpolatedCurve curve;
+};
+
+// dense integer handles for market objects, resolved once from the names
+struct CurveHandle {
+	int id = -1;
+	inline bool valid() const { return id >= 0; }
 };
 
+struct VolHandle {
+	int id = -1;
+	inline bool valid() const { return id >= 0; }
+};
+
+struct PriceHandle {
+	int id = -1;
+	inline bool valid() const { return id >= 0; }
+};
+
+// name <-> id table for one kind of market object, ids are assigned in registration order
+class HandleTable {
+public:
+	inline int find(const string& name) const {
+		auto it = ids.find(name);
+		return it == ids.end() ? -1 : it->second;
+	}
+	inline int at(const string& name) const {
+		int id = find(name);
+		if (id < 0)
+			throw std::out_of_range("Error: unknown market object " + name);
+		return id;
+	}
+	inline int add(const string& name) {
+		auto inserted = ids.emplace(name, int(names.size()));
+		if (inserted.second)
+			names.push_back(name);
+		return inserted.first->second;
+	}
+	inline const vector<string>& getNames() const { return names; }
+	inline size_t size() const { return names.size(); }
+
+private:
+	unordered_map<string, int> ids;
+	vector<string> names;
+};
+
+// Values of one kind of market object, by id. The base table is shared by every snapshot
+// derived from the same build, a derived snapshot keeps the entries it replaced in a short
+// list on top. Copying a market or bumping one object then costs the replaced entries, not
+// the size of the table. The list is folded into a fresh table once it grows past
+// MAX_REPLACED, so lookups stay a short scan plus an index.
+template <class T>
+class SlotTable {
+public:
+	static constexpr size_t MAX_REPLACED = 8;
+
+	inline const T& operator[](size_t id) const {
+		for (const auto& r : replaced) {
+			if (r.first == id)
+				return r.second;
+		}
+		return (*base)[id];
+	}
+	inline size_t size() const { return base->size(); }
+
+	// building, the table is copied first when another snapshot shares it
+	inline void push_back(const T& value) { edit().push_back(value); }
+
+	// derived snapshots
+	void set(size_t id, const T& value) {
+		for (auto& r : replaced) {
+			if (r.first == id) {
+				r.second = value;
+				return;
+			}
+		}
+		replaced.emplace_back(id, value);
+		if (replaced.size() > MAX_REPLACED)
+			edit();
+	}
+
+private:
+	vector<T>& edit() {
+		if (base.use_count() != 1 || !replaced.empty()) {
+			auto copy = make_shared<vector<T>>(*base);
+			for (const auto& r : replaced)
+				(*copy)[r.first] = r.second;
+			replaced.clear();
+			base = copy;
+		}
+		return *base;
+	}
+
+	shared_ptr<vector<T>> base = make_shared<vector<T>>();
+	vector<pair<size_t, T>> replaced;
+};
+
+struct MarketRegistry {
+	HandleTable curves;
+	HandleTable vols;
+	HandleTable bonds;
+	HandleTable stocks;
+};
+
+// A Market is an immutable snapshot once it is built. Curves and prices are held in
+// SlotTables, so copying a market is cheap and a shocked market (withCurve, withShockedCurve,
+// ...) shares everything it did not change with its parent.
+// Every snapshot carries its own version number.
+//
+// Objects are registered into dense ids when they are added. The registry is shared by
+// every snapshot derived from the market, so a handle resolved once stays valid for all
+// of them and the pricing path indexes straight into the tables, with no hashing and no
+// shared_ptr copies.
 class Market
 {
 public:
 	Date asOf;
 	char* name;
 
-	Market() {
+	Market() : version(nextVersion()) {
 		//cout << "default market constructor is called by object@" << this << endl;
 	}
 
-	Market(const Date& now) : asOf(now) {
+	Market(const Date& now) : asOf(now), version(nextVersion()) {
 		//cout << "market constructor is called by object@" << this << endl;
 		//name = new char[5];
 		//strcpy_s(name, 5, "test");
 	}
 
-	// for risk engine
-	Market(const Market& other) {
-		this->asOf = other.asOf;
-		// Deep copy each Curve
-		for (const auto& curve : other.curves) {
-			curves.emplace(curve.first, std::make_shared<RateCurve>(*curve.second)); // Deep copy each Curve
-		}
-		// Deep copy each Curve
-		for (const auto& vol : other.vols) {
-			vols.emplace(vol.first, std::make_shared<VolCurve>(*vol.second)); // Deep copy each Curve
-		}
-		bondPrices = other.bondPrices;
-		stockPrices = other.stockPrices;
-	};
-
-	Market& operator=(const Market& other) {
-		//cout << "assignment constructor is called by object@" << this << endl;
-		if (this != &other) {  // Check for self-assignment
-			asOf = other.asOf;
-		}
-		return *this;
-	}
+	// shallow copies, the curves and price tables are shared and never modified in place
+	Market(const Market& other) = default;
+	Market& operator=(const Market& other) = default;
 
 	//~Market() {
 	//	//cout << "Market destructor is called" << endl;
@@ -85,24 +239,71 @@ public:
 	//}
 
 	void Print() const;
+	vector<string> getCurveNames() const;
+	vector<string> getVolNames() const;
+
+	// versioned binary snapshot with the compiled curves, loaded through a memory map with no
+	// parsing and no recompiling (MarketSnapshot.cpp)
+	void saveSnapshot(const string& filename) const;
+	static Market loadSnapshot(const string& filename);
+
+	// building, only while the market is not shared yet
 	void addCurve(const std::string& name, shared_ptr<RateCurve> curve);
 	void addVolCurve(const std::string& name, shared_ptr<VolCurve> vol);
 	void addBondPrice(const std::string& bondName, double price);
 	void addStockPrice(const std::string& stockName, double price);
 
-	inline void shockPrice(const string& underlying, double shock) { stockPrices[underlying] += shock; }
-	inline shared_ptr<RateCurve> getCurve(const string& name) const { return curves.at(name); };
-	inline shared_ptr<VolCurve> getVolCurve(const string& name) const { return vols.at(name); };
+	// derived snapshots, only the replaced object is new
+	Market withCurve(const string& name, shared_ptr<const RateCurve> curve) const;
+	Market withVolCurve(const string& name, shared_ptr<const VolCurve> vol) const;
+	Market withShockedCurve(const string& name, const Date& tenor, double shock) const;
+	Market withShockedVolCurve(const string& name, const Date& tenor, double shock) const;
+	Market withShockedPrice(const string& underlying, double shock) const;
+	Market withStockPrice(const string& underlying, double price) const;
+
+	// handle resolution, an unknown name gives an invalid handle
+	inline CurveHandle getCurveHandle(const string& name) const { return CurveHandle{ registry->curves.find(name) }; }
+	inline VolHandle getVolHandle(const string& name) const { return VolHandle{ registry->vols.find(name) }; }
+	inline PriceHandle getStockHandle(const string& name) const { return PriceHandle{ registry->stocks.find(name) }; }
+
+	// pricing path. a handle is only valid for the market that resolved it and the snapshots
+	// derived from that market (withCurve, withShockedPrice, ...), which keep its ids. one
+	// resolved against an unrelated market indexes the wrong object, only debug builds check
+	// the range
+	inline const RateCurve& getCurve(CurveHandle h) const {
+		assert(h.id >= 0 && size_t(h.id) < curves.size());
+		return *curves[h.id];
+	}
+	inline const VolCurve& getVolCurve(VolHandle h) const {
+		assert(h.id >= 0 && size_t(h.id) < vols.size());
+		return *vols[h.id];
+	}
+	inline double getstockPrice(PriceHandle h) const {
+		assert(h.id >= 0 && size_t(h.id) < stockPrices.size());
+		return stockPrices[h.id];
+	}
+
+	// by name
+	inline shared_ptr<const RateCurve> getCurve(const string& name) const { return curves[registry->curves.at(name)]; };
+	inline shared_ptr<const VolCurve> getVolCurve(const string& name) const { return vols[registry->vols.at(name)]; };
+
+	inline double getbondPrice(const string& name) const { return bondPrices[registry->bonds.at(name)]; };
+	inline double getstockPrice(const string& name) const { return stockPrices[registry->stocks.at(name)]; };
 
-	inline double getbondPrice(const string& name) const { return bondPrices.at(name); };
-	inline double getstockPrice(const string& name) const { return stockPrices.at(name); };
+	inline unsigned long long getVersion() const { return version; }
+	inline shared_ptr<const MarketRegistry> getRegistry() const { return registry; }
 
 private:
+	static unsigned long long nextVersion();
+	MarketRegistry& editRegistry();
+	int stockSlot(const string& underlying);
 
-	unordered_map<string, shared_ptr<VolCurve>> vols;
-	unordered_map<string, shared_ptr<RateCurve>> curves;
-	unordered_map<string, double> bondPrices;
-	unordered_map<string, double> stockPrices;
+	shared_ptr<MarketRegistry> registry = make_shared<MarketRegistry>();
+	SlotTable<shared_ptr<const VolCurve>> vols;
+	SlotTable<shared_ptr<const RateCurve>> curves;
+	SlotTable<double> bondPrices;
+	SlotTable<double> stockPrices;
+	unsigned long long version;
 };
 
 std::ostream& operator<<(std::ostream& os, const Market& obj);
@@ -0,0 +1,213 @@
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+#include "Market.h"
+#include "MarketSnapshot.h"
+#include "MappedFile.h"
+
+using namespace std;
+using namespace SNAPSHOT;
+
+void Market::saveSnapshot(const string& filename) const
+{
+	size_t nCurves = curves.size();
+	size_t nVols = vols.size();
+	size_t nBonds = bondPrices.size();
+	size_t nStocks = stockPrices.size();
+
+	Header header = {};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.endianTag = ENDIAN_TAG;
+	header.asOf = asOf.serialDay();
+	header.nCurves = uint32_t(nCurves);
+	header.nVols = uint32_t(nVols);
+	header.nBonds = uint32_t(nBonds);
+	header.nStocks = uint32_t(nStocks);
+	header.curveOffset = sizeof(Header);
+	header.priceOffset = header.curveOffset + (nCurves + nVols) * sizeof(CurveRecord);
+	uint64_t dataOffset = header.priceOffset + (nBonds + nStocks) * sizeof(PriceRecord);
+
+	vector<CurveRecord> curveRecords;
+	vector<PriceRecord> priceRecords;
+	vector<char> data;
+	string strings;
+
+	auto addString = [&](const string& s, uint32_t& offset, uint32_t& length) {
+		offset = uint32_t(strings.size());
+		length = uint32_t(s.size());
+		strings += s;
+	};
+	auto addBytes = [&](const void* p, size_t bytes) {
+		const char* c = static_cast<const char*>(p);
+		data.insert(data.end(), c, c + bytes);
+		data.resize(size_t(align8(data.size())), 0);
+	};
+	auto addCurve = [&](const string& key, const string& curveName, const vector<Date>& dates, const vector<double>& values,
+		const Date& anchor, InterpolationType interpolation, const InterpolatedCurve& curve) {
+		if (curve.empty())
+			throw std::runtime_error("Error: cannot snapshot uncompiled curve " + curveName);
+		size_t n = dates.size();
+		CurveRecord r = {};
+		addString(key, r.nameOffset, r.nameLength);
+		addString(curveName, r.curveNameOffset, r.curveNameLength);
+		r.anchor = anchor.serialDay();
+		r.interpolation = uint32_t(interpolation);
+		r.nPillars = uint32_t(n);
+		r.reach = uint32_t(curve.getReach());
+		r.onRateTime = curve.isOnRateTime() ? 1 : 0;
+		r.front = curve.getFront();
+		r.dataOffset = dataOffset + data.size();
+
+		vector<int32_t> serials(n);
+		for (size_t i = 0; i < n; ++i)
+			serials[i] = dates[i].serialDay();
+		addBytes(serials.data(), n * sizeof(int32_t));
+		addBytes(values.data(), n * sizeof(double));
+		addBytes(curve.getTimes().data(), n * sizeof(double));
+		addBytes(curve.getSegments().data(), n * sizeof(Segment));
+		curveRecords.push_back(r);
+	};
+	auto addPrices = [&](const HandleTable& names, const SlotTable<double>& prices) {
+		for (size_t i = 0; i < prices.size(); ++i) {
+			PriceRecord r = {};
+			addString(names.getNames()[i], r.nameOffset, r.nameLength);
+			r.price = prices[i];
+			priceRecords.push_back(r);
+		}
+	};
+
+	for (size_t i = 0; i < nCurves; ++i) {
+		const RateCurve& rc = *curves[i];
+		addCurve(registry->curves.getNames()[i], rc.name, rc.tenorDates, rc.rates, rc.anchor, rc.interpolation, rc.curve);
+	}
+	for (size_t i = 0; i < nVols; ++i) {
+		const VolCurve& vc = *vols[i];
+		addCurve(registry->vols.getNames()[i], vc.name, vc.tenors, vc.vols, vc.anchor, LinearZero, vc.curve);
+	}
+	addPrices(registry->bonds, bondPrices);
+	addPrices(registry->stocks, stockPrices);
+
+	header.stringOffset = dataOffset + data.size();
+	header.stringSize = strings.size();
+	header.fileSize = header.stringOffset + header.stringSize;
+
+	// written next to the target and renamed over it, a crash never leaves a half written snapshot
+	string tmpName = filename + ".tmp";
+	{
+		ofstream out(tmpName, ios::binary | ios::trunc);
+		if (!out)
+			throw std::runtime_error("Error opening file " + tmpName);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		out.write(reinterpret_cast<const char*>(curveRecords.data()), curveRecords.size() * sizeof(CurveRecord));
+		out.write(reinterpret_cast<const char*>(priceRecords.data()), priceRecords.size() * sizeof(PriceRecord));
+		out.write(data.data(), data.size());
+		out.write(strings.data(), strings.size());
+		if (!out)
+			throw std::runtime_error("Error writing file " + tmpName);
+	}
+	std::filesystem::rename(tmpName, filename);
+}
+
+Market Market::loadSnapshot(const string& filename)
+{
+	MappedFile file(filename);
+	const char* base = file.data();
+	uint64_t size = file.size();
+
+	auto check = [&](uint64_t offset, uint64_t bytes) {
+		if (offset > size || bytes > size - offset)
+			throw std::runtime_error("Error: truncated market snapshot " + filename);
+	};
+
+	check(0, sizeof(Header));
+	Header header;
+	memcpy(&header, base, sizeof(Header));
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+		throw std::runtime_error("Error: " + filename + " is not a market snapshot");
+	if (header.version != VERSION)
+		throw std::runtime_error("Error: unsupported market snapshot version " + to_string(header.version));
+	if (header.endianTag != ENDIAN_TAG)
+		throw std::runtime_error("Error: market snapshot " + filename + " has a different byte order");
+	if (header.fileSize != size)
+		throw std::runtime_error("Error: truncated market snapshot " + filename);
+
+	uint64_t nCurveRecords = uint64_t(header.nCurves) + header.nVols;
+	uint64_t nPriceRecords = uint64_t(header.nBonds) + header.nStocks;
+	check(header.curveOffset, nCurveRecords * sizeof(CurveRecord));
+	check(header.priceOffset, nPriceRecords * sizeof(PriceRecord));
+	check(header.stringOffset, header.stringSize);
+
+	auto readString = [&](uint32_t offset, uint32_t length) {
+		if (uint64_t(offset) + length > header.stringSize)
+			throw std::runtime_error("Error: corrupt string table in market snapshot " + filename);
+		return string(base + header.stringOffset + offset, length);
+	};
+
+	// sections are 8 byte aligned in the file and the mapping is page aligned, the pillar
+	// arrays are read in place
+	auto readCurve = [&](const CurveRecord& r, vector<Date>& dates, vector<double>& values, InterpolatedCurve& curve) {
+		uint64_t n = r.nPillars;
+		uint64_t valuesOffset = r.dataOffset + align8(n * sizeof(int32_t));
+		uint64_t timesOffset = valuesOffset + n * sizeof(double);
+		uint64_t segsOffset = timesOffset + n * sizeof(double);
+		if (n == 0 || r.dataOffset % 8 != 0)
+			throw std::runtime_error("Error: corrupt curve in market snapshot " + filename);
+		check(r.dataOffset, segsOffset + n * sizeof(Segment) - r.dataOffset);
+
+		const int32_t* serials = reinterpret_cast<const int32_t*>(base + r.dataOffset);
+		const double* v = reinterpret_cast<const double*>(base + valuesOffset);
+		dates.resize(size_t(n));
+		for (size_t i = 0; i < n; ++i)
+			dates[i] = Date::fromSerial(serials[i]);
+		values.assign(v, v + n);
+		curve.restore(reinterpret_cast<const double*>(base + timesOffset), reinterpret_cast<const Segment*>(base + segsOffset),
+			size_t(n), r.front, r.onRateTime != 0, int(r.reach));
+	};
+
+	Market mkt(Date::fromSerial(header.asOf));
+	auto registry = make_shared<MarketRegistry>();
+
+	for (uint64_t i = 0; i < nCurveRecords; ++i) {
+		CurveRecord r;
+		memcpy(&r, base + header.curveOffset + i * sizeof(CurveRecord), sizeof(CurveRecord));
+		string key = readString(r.nameOffset, r.nameLength);
+		string curveName = readString(r.curveNameOffset, r.curveNameLength);
+
+		if (i < header.nCurves) {
+			if (r.interpolation > FlatForward)
+				throw std::runtime_error("Error: unknown interpolation for " + key + " in market snapshot " + filename);
+			auto rc = make_shared<RateCurve>(curveName);
+			rc->interpolation = InterpolationType(r.interpolation);
+			rc->anchor = Date::fromSerial(r.anchor);
+			readCurve(r, rc->tenorDates, rc->rates, rc->curve);
+			if (registry->curves.add(key) != int(mkt.curves.size()))
+				throw std::runtime_error("Error: duplicate curve " + key + " in market snapshot " + filename);
+			mkt.curves.push_back(rc);
+		}
+		else {
+			auto vc = make_shared<VolCurve>(curveName);
+			vc->anchor = Date::fromSerial(r.anchor);
+			readCurve(r, vc->tenors, vc->vols, vc->curve);
+			if (registry->vols.add(key) != int(mkt.vols.size()))
+				throw std::runtime_error("Error: duplicate vol curve " + key + " in market snapshot " + filename);
+			mkt.vols.push_back(vc);
+		}
+	}
+
+	for (uint64_t i = 0; i < nPriceRecords; ++i) {
+		PriceRecord r;
+		memcpy(&r, base + header.priceOffset + i * sizeof(PriceRecord), sizeof(PriceRecord));
+		string key = readString(r.nameOffset, r.nameLength);
+		bool isBond = i < header.nBonds;
+		auto& table = isBond ? registry->bonds : registry->stocks;
+		auto& prices = isBond ? mkt.bondPrices : mkt.stockPrices;
+		if (table.add(key) != int(prices.size()))
+			throw std::runtime_error("Error: duplicate price " + key + " in market snapshot " + filename);
+		prices.push_back(r.price);
+	}
+
+	mkt.registry = registry;
+	return mkt;
+}
@@ -0,0 +1,71 @@
+#ifndef MARKET_SNAPSHOT_H
+#define MARKET_SNAPSHOT_H
+
+#include <cstdint>
+#include <type_traits>
+
+#include "Interpolation.h"
+
+// On-disk layout of Market::saveSnapshot. Little endian, every section 8 byte aligned so the
+// mapped file can be read in place.
+//
+//   Header
+//   CurveRecord[nCurves], CurveRecord[nVols]
+//   PriceRecord[nBonds], PriceRecord[nStocks]
+//   per curve: int32 pillar dates[n] (padded to 8), double values[n], double times[n], Segment[n]
+//   string table, names are referenced by offset and length
+//
+// Bump VERSION whenever any of the structs below changes.
+namespace SNAPSHOT
+{
+	constexpr char MAGIC[8] = { 'Q', 'F', 'M', 'K', 'T', 'S', 'N', 'P' };
+	constexpr uint32_t VERSION = 1;
+	constexpr uint32_t ENDIAN_TAG = 0x01020304;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t endianTag;
+		int32_t asOf; // serial day
+		uint32_t nCurves;
+		uint32_t nVols;
+		uint32_t nBonds;
+		uint32_t nStocks;
+		uint32_t reserved;
+		uint64_t curveOffset; // rate curve records, vol records follow
+		uint64_t priceOffset; // bond records, stock records follow
+		uint64_t stringOffset;
+		uint64_t stringSize;
+		uint64_t fileSize;
+	};
+
+	struct CurveRecord {
+		uint32_t nameOffset; // market key
+		uint32_t nameLength;
+		uint32_t curveNameOffset; // name the curve carries itself
+		uint32_t curveNameLength;
+		int32_t anchor; // serial day
+		uint32_t interpolation;
+		uint32_t nPillars;
+		uint32_t reach;
+		uint32_t onRateTime;
+		uint32_t reserved;
+		double front;
+		uint64_t dataOffset;
+	};
+
+	struct PriceRecord {
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		double price;
+	};
+
+	inline uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+	static_assert(sizeof(Header) % 8 == 0, "snapshot header must stay 8 byte aligned");
+	static_assert(sizeof(CurveRecord) % 8 == 0, "snapshot curve record must stay 8 byte aligned");
+	static_assert(sizeof(PriceRecord) % 8 == 0, "snapshot price record must stay 8 byte aligned");
+	static_assert(sizeof(Segment) == 4 * sizeof(double) && std::is_trivially_copyable<Segment>::value, "segments are stored raw");
+}
+
+#endif
@@ -0,0 +1,218 @@
+#include <cmath>
+#include <algorithm>
+#include <typeinfo>
+#include <type_traits>
+#include <stdexcept>
+
+#include "PortfolioStore.h"
+#include "Swap.h"
+#include "Bond.h"
+#include "EuropeanTrade.h"
+#include "AmericanTrade.h"
+#include "TreeKernel.h"
+
+void LinearTable::addSwap(uint32_t r, int32_t c, double n, double swapRate, const Schedule& schedule, const Date& end, bool pay)
+{
+	row.push_back(r);
+	curve.push_back(c);
+	notional.push_back(n);
+	sign.push_back(pay ? -1.0 : 1.0);
+	rate.push_back(swapRate);
+	fixed.push_back(-1.0);
+
+	// float leg at par, pays back the notional at the end date
+	cfDate.push_back(end.serialDay());
+	cfWeight.push_back(1.0);
+	for (size_t i = 1; i < schedule.dates.size(); i++) {
+		cfDate.push_back(schedule.dates[i].serialDay());
+		cfWeight.push_back(schedule.accruals[i] * swapRate);
+	}
+	cfBegin.push_back(uint32_t(cfDate.size()));
+}
+
+void LinearTable::addBond(uint32_t r, int32_t c, double n, double coupon, double frequency, const Schedule& schedule,
+	const Date& end, bool isLong)
+{
+	row.push_back(r);
+	curve.push_back(c);
+	notional.push_back(n);
+	sign.push_back(isLong ? 1.0 : -1.0);
+	rate.push_back(coupon);
+	fixed.push_back(0.0);
+
+	// per unit of notional, coupons then the principal
+	for (const auto& dt : schedule.dates) {
+		cfDate.push_back(dt.serialDay());
+		cfWeight.push_back(coupon * frequency);
+	}
+	cfDate.push_back(end.serialDay());
+	cfWeight.push_back(1.0);
+	cfBegin.push_back(uint32_t(cfDate.size()));
+}
+
+bool LinearTable::isLinear(const Trade& trade)
+{
+	const auto& type = typeid(trade);
+	return type == typeid(Swap) || type == typeid(Bond);
+}
+
+bool LinearTable::addTrade(uint32_t r, int32_t c, const Trade& trade)
+{
+	const auto& type = typeid(trade);
+	if (type == typeid(Swap)) {
+		const auto& swap = static_cast<const Swap&>(trade);
+		addSwap(r, c, swap.getNotional(), swap.getRate(), *swap.getSchedule(), swap.getEndDate(), swap.getDirection() == "pay");
+		return true;
+	}
+	if (type == typeid(Bond)) {
+		const auto& bond = static_cast<const Bond&>(trade);
+		addBond(r, c, bond.getNotional(), bond.getCoupon(), bond.getFrequency(), *bond.getSchedule(), bond.getEndDate(),
+			bond.getDirection() == "long");
+		return true;
+	}
+	return false;
+}
+
+void LinearTable::price(const Market& mkt, double* pv) const
+{
+	size_t n = size();
+	vector<double> t(cfDate.size());
+	vector<double> df(cfDate.size());
+
+	for (size_t r0 = 0; r0 < n;) {
+		size_t r1 = r0 + 1;
+		while (r1 < n && curve[r1] == curve[r0])
+			++r1;
+
+		const RateCurve& rc = mkt.getCurve(CurveHandle{ curve[r0] });
+		int32_t anchor = rc.getAnchor().serialDay();
+		size_t b = cfBegin[r0];
+		size_t e = cfBegin[r1];
+		for (size_t j = b; j < e; ++j)
+			t[j] = (cfDate[j] - anchor) / 365.0;
+		rc.getDf(t.data() + b, df.data() + b, e - b);
+
+		for (size_t r = r0; r < r1; ++r) {
+			double sum = fixed[r];
+			for (size_t j = cfBegin[r]; j < cfBegin[r + 1]; ++j)
+				sum += cfWeight[j] * df[j];
+			pv[row[r]] = sign[r] * notional[r] * sum;
+		}
+		r0 = r1;
+	}
+}
+
+template <bool American>
+void OptionTable::price(const Market& mkt, int nSteps, double* pv) const
+{
+	vector<double> states(nSteps + 1);
+	vector<double> spots(nSteps + 1);
+	int32_t asOf = mkt.asOf.serialDay();
+
+	for (size_t r = 0; r < size(); ++r) {
+		const RateCurve& rc = mkt.getCurve(CurveHandle{ curve[r] });
+		const VolCurve& vc = mkt.getVolCurve(VolHandle{ vol[r] });
+		double T = (expiry[r] - asOf) / 365.0;
+		double s0 = mkt.getstockPrice(PriceHandle{ spot[r] });
+		double sigma = vc.getVol((expiry[r] - vc.getAnchor().serialDay()) / 365.0);
+		double rate = rc.getRate((expiry[r] - rc.getAnchor().serialDay()) / 365.0);
+
+		// the CRR instantiation CRRBinomialTreePricer uses for these products
+		using Exercise = typename std::conditional<American, LATTICE::American, LATTICE::European>::type;
+		double value = LATTICE::priceVanilla<Exercise>(LATTICE::Model::CRR, OptionType(optType[r]), strike[r],
+			LATTICE::Inputs{ T, s0, sigma, rate }, nSteps, states.data(), spots.data());
+		pv[row[r]] = sign[r] * notional[r] * value;
+	}
+}
+
+uint32_t PortfolioStore::newRow(const string& id)
+{
+	tradeIds.push_back(id);
+	return uint32_t(tradeIds.size() - 1);
+}
+
+int32_t PortfolioStore::curveId(const string& name) const
+{
+	return registry->curves.at(name);
+}
+
+bool PortfolioStore::add(const Trade& trade)
+{
+	// exact types only, derived products (call spreads, ...) have their own payoffs
+	const auto& type = typeid(trade);
+	if (type == typeid(Swap)) {
+		int32_t c = curveId(trade.getCurvename());
+		swaps.addTrade(newRow(trade.getTradeid()), c, trade);
+	}
+	else if (type == typeid(Bond)) {
+		int32_t c = curveId(trade.getCurvename());
+		bonds.addTrade(newRow(trade.getTradeid()), c, trade);
+	}
+	else if (type == typeid(EuropeanOption)) {
+		const auto& opt = static_cast<const EuropeanOption&>(trade);
+		addEuropean(trade.getTradeid(), opt.getCurvename(), opt.getVolname(), opt.getUnderlying(),
+			opt.getNotional(), opt.getStrike(), opt.getOptionType(), opt.GetExpiry(), opt.getDirection() == "long");
+	}
+	else if (type == typeid(AmericanOption)) {
+		const auto& opt = static_cast<const AmericanOption&>(trade);
+		addAmerican(trade.getTradeid(), opt.getCurvename(), opt.getVolname(), opt.getUnderlying(),
+			opt.getNotional(), opt.getStrike(), opt.getOptionType(), opt.GetExpiry(), opt.getDirection() == "long");
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+void PortfolioStore::addSwap(const string& id, const string& curveName, double notional, double rate,
+	const Schedule& schedule, const Date& end, bool pay)
+{
+	int32_t c = curveId(curveName);
+	swaps.addSwap(newRow(id), c, notional, rate, schedule, end, pay);
+}
+
+void PortfolioStore::addBond(const string& id, const string& curveName, double notional, double coupon, double frequency,
+	const Schedule& schedule, const Date& end, bool isLong)
+{
+	int32_t c = curveId(curveName);
+	bonds.addBond(newRow(id), c, notional, coupon, frequency, schedule, end, isLong);
+}
+
+void PortfolioStore::addEuropean(const string& id, const string& curveName, const string& volName, const string& underlying,
+	double notional, double strike, OptionType optType, const Date& expiry, bool isLong)
+{
+	addOption(europeans, id, curveName, volName, underlying, notional, strike, optType, expiry, isLong);
+}
+
+void PortfolioStore::addAmerican(const string& id, const string& curveName, const string& volName, const string& underlying,
+	double notional, double strike, OptionType optType, const Date& expiry, bool isLong)
+{
+	addOption(americans, id, curveName, volName, underlying, notional, strike, optType, expiry, isLong);
+}
+
+void PortfolioStore::addOption(OptionTable& table, const string& id, const string& curveName, const string& volName, const string& underlying,
+	double notional, double strike, OptionType optType, const Date& expiry, bool isLong)
+{
+	int32_t c = curveId(curveName);
+	int32_t v = registry->vols.at(volName);
+	int32_t s = registry->stocks.at(underlying);
+	table.row.push_back(newRow(id));
+	table.curve.push_back(c);
+	table.vol.push_back(v);
+	table.spot.push_back(s);
+	table.notional.push_back(notional);
+	table.sign.push_back(isLong ? 1.0 : -1.0);
+	table.strike.push_back(strike);
+	table.expiry.push_back(expiry.serialDay());
+	table.optType.push_back(uint8_t(optType));
+}
+
+vector<double> PortfolioStore::price(const Market& mkt, int nSteps) const
+{
+	vector<double> pv(size(), 0.0);
+	swaps.price(mkt, pv.data());
+	bonds.price(mkt, pv.data());
+	europeans.price<false>(mkt, nSteps, pv.data());
+	americans.price<true>(mkt, nSteps, pv.data());
+	return pv;
+}
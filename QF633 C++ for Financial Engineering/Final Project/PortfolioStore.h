@@ -0,0 +1,111 @@
+#ifndef PORTFOLIO_STORE_H
+#define PORTFOLIO_STORE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "Date.h"
+#include "Market.h"
+#include "Trade.h"
+#include "Types.h"
+#include "ScheduleCache.h"
+
+using namespace std;
+
+// Linear products as weighted cashflows, pv = sign * notional * (fixed + sum_j w_j * df(t_j)).
+// A swap is fixed = -1 (float leg) with w = 1 at the end date and tau * rate on the fixed
+// dates, a bond is the coupon payments plus the principal at maturity. addSwap and addBond
+// are the one definition of these cashflows for every flat view of the book (this store and
+// CashflowStore), built from the interned schedule as Swap::Pv and Bond::Pv are.
+struct LinearTable {
+	vector<uint32_t> row;     // position in the store
+	vector<int32_t> curve;    // CurveHandle id
+	vector<double> notional;
+	vector<double> sign;      // +1 receive / long, -1 pay / short
+	vector<double> rate;      // swap fixed rate, bond coupon
+	vector<double> fixed;
+	vector<uint32_t> cfBegin{ 0 }; // cashflows of row r are [cfBegin[r], cfBegin[r + 1])
+	vector<int32_t> cfDate;   // serial day
+	vector<double> cfWeight;
+
+	inline size_t size() const { return row.size(); }
+
+	// the schedule already leaves out the dates before its value date
+	void addSwap(uint32_t row, int32_t curve, double notional, double rate, const Schedule& schedule, const Date& end, bool pay);
+	void addBond(uint32_t row, int32_t curve, double notional, double coupon, double frequency, const Schedule& schedule,
+		const Date& end, bool isLong);
+	// a Swap or Bond object (exact types), false for any other product
+	bool addTrade(uint32_t row, int32_t curve, const Trade& trade);
+	static bool isLinear(const Trade& trade);
+
+	// rows on the same curve next to each other are discounted in one batch
+	void price(const Market& mkt, double* pv) const;
+};
+
+// vanilla options on a spot, priced on a CRR tree
+struct OptionTable {
+	vector<uint32_t> row;
+	vector<int32_t> curve;    // CurveHandle id
+	vector<int32_t> vol;      // VolHandle id
+	vector<int32_t> spot;     // PriceHandle id
+	vector<double> notional;
+	vector<double> sign;
+	vector<double> strike;
+	vector<int32_t> expiry;   // serial day
+	vector<uint8_t> optType;  // OptionType
+
+	inline size_t size() const { return row.size(); }
+
+	template <bool American>
+	void price(const Market& mkt, int nSteps, double* pv) const;
+};
+
+// Columnar book, one struct-of-arrays table per product. Trade ids are the only strings and
+// live once in the store, curve, vol and spot names are resolved to market handles when a
+// trade is added. Handles are shared by every snapshot derived from the market the store
+// was built against.
+class PortfolioStore
+{
+public:
+	explicit PortfolioStore(const Market& mkt) : registry(mkt.getRegistry()) {};
+
+	// copies an existing trade object in, false when the product has no table
+	bool add(const Trade& trade);
+
+	// cashflows from the interned schedule, see LinearTable
+	void addSwap(const string& id, const string& curveName, double notional, double rate,
+		const Schedule& schedule, const Date& end, bool pay);
+	void addBond(const string& id, const string& curveName, double notional, double coupon, double frequency,
+		const Schedule& schedule, const Date& end, bool isLong);
+	void addEuropean(const string& id, const string& curveName, const string& volName, const string& underlying,
+		double notional, double strike, OptionType optType, const Date& expiry, bool isLong);
+	void addAmerican(const string& id, const string& curveName, const string& volName, const string& underlying,
+		double notional, double strike, OptionType optType, const Date& expiry, bool isLong);
+
+	// pv per row, in the order the trades were added
+	vector<double> price(const Market& mkt, int nSteps) const;
+
+	inline size_t size() const { return tradeIds.size(); }
+	inline const string& getTradeId(size_t row) const { return tradeIds[row]; }
+	inline const LinearTable& getSwaps() const { return swaps; }
+	inline const LinearTable& getBonds() const { return bonds; }
+	inline const OptionTable& getEuropeans() const { return europeans; }
+	inline const OptionTable& getAmericans() const { return americans; }
+
+private:
+	uint32_t newRow(const string& id);
+	int32_t curveId(const string& name) const;
+	void addOption(OptionTable& table, const string& id, const string& curveName, const string& volName, const string& underlying,
+		double notional, double strike, OptionType optType, const Date& expiry, bool isLong);
+
+	shared_ptr<const MarketRegistry> registry;
+	vector<string> tradeIds;
+	LinearTable swaps;
+	LinearTable bonds;
+	OptionTable europeans;
+	OptionTable americans;
+};
+
+#endif
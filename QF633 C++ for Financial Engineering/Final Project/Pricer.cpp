@@ -1,4 +1,8 @@
 #include <cmath>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <typeinfo>
 #include "Pricer.h"
 #include "Bond.h"
 #include "Swap.h"
@@ -7,7 +11,7 @@
 #include "black.h"
 
 
-double Pricer::Price(const Market& mkt, shared_ptr<Trade> trade) {
+double Pricer::Price(const Market& mkt, const shared_ptr<Trade>& trade) {
 	double pv = 0;
 	if (trade->getType() == "TreeProduct") {
 		auto treePtr = dynamic_cast<TreeProduct*>(trade.get());
@@ -26,53 +30,145 @@ double Pricer::Price(const Market& mkt, shared_ptr<Trade> trade) {
 void BinomialTreePricer::ModelSetup(double S0, double sigma, double r, double dt)
 {
 	// a basic version of binomial tree
-	u = 1.1;
-	d = 0.9;
-	p = (exp(r) - d) / (u - d);
+	LATTICE::Basic::setup(sigma, r, dt, u, d, p);
+	currentSpot = S0;
 }
 
 double BinomialTreePricer::PriceTree(const Market& mkt, const TreeProduct& trade) {
-	double T = (trade.GetExpiry() - mkt.asOf) / 365.0;
-	double dt = T / nTimeSteps;
-	double s0 = mkt.getstockPrice(trade.getUnderlying());
-	auto volCurve = mkt.getVolCurve(trade.getVolname());
-	double vol = volCurve->getVol(trade.GetExpiry());
-	auto irCurve = mkt.getCurve("USD-SOFR");
-	double rate = irCurve->getRate(trade.GetExpiry());
-	ModelSetup(s0, vol, rate, dt);
+	return PriceTree(mkt, trade, nullptr);
+}
+
+double BinomialTreePricer::PriceWithGreeks(const Market& mkt, const TreeProduct& trade, LATTICE::Greeks& greeks)
+{
+	double scale = trade.getDirection() == "long" ? trade.getNotional() : -trade.getNotional();
+	double pv = PriceTree(mkt, trade, &greeks) * scale;
+	greeks.delta *= scale;
+	greeks.gamma *= scale;
+	greeks.theta *= scale;
+	return pv;
+}
+
+double BinomialTreePricer::PriceTree(const Market& mkt, const TreeProduct& trade, LATTICE::Greeks* greeks) {
+	auto in = trade.treeInputs(mkt);
+	double value;
+	if (trade.latticePrice(LatticeModel(), in, nTimeSteps, states.data(), spots.data(), value, greeks))
+		return value;
+
+	// products without a lattice instantiation, node by node through the virtual payoff
+	double dt = in.T / nTimeSteps;
+	double rate = in.rate;
+	ModelSetup(in.spot, in.vol, rate, dt);
+
+	// discounted branch probabilities, the same at every node
+	double df = exp(-rate * dt);
+	double pu = df * GetProbUp();
+	double pd = df * GetProbDown();
+	double* v = states.data();
+	double* s = spots.data();
 
 	// initialize
+	SpotLadder(nTimeSteps, s);
 	for (int i = 0; i <= nTimeSteps; i++) {
-		states[i] = trade.Payoff(GetSpot(nTimeSteps, i));
+		v[i] = trade.Payoff(s[i]);
 	}
 
 	// price by backward induction
-	for (int k = nTimeSteps - 1; k >= 0; k--)
-		for (int i = 0; i <= k; i++) {
-			// calculate continuation value
-			double df = exp(-rate * dt);
-			double continuation = df * (states[i] * GetProbUp() + states[i + 1] * GetProbDown());
-			// calculate the option value at node(k, i)
-			states[i] = trade.ValueAtNode(GetSpot(k, i), dt * k, continuation);
+	double v1[2] = {}, s1[2] = {}, v2[3] = {}, s2[3] = {};
+	for (int k = nTimeSteps - 1; k >= 0; k--) {
+		// continuation values, a plain loop over the buffer
+		for (int i = 0; i <= k; i++)
+			v[i] = pu * v[i] + pd * v[i + 1];
+		// the option value at node(k, i)
+		SpotLadder(k, s);
+		double t = dt * k;
+		for (int i = 0; i <= k; i++)
+			v[i] = trade.ValueAtNode(s[i], t, v[i]);
+
+		if (greeks && k == 2) {
+			std::copy(v, v + 3, v2);
+			std::copy(s, s + 3, s2);
+		}
+		if (greeks && k == 1) {
+			std::copy(v, v + 2, v1);
+			std::copy(s, s + 2, s1);
 		}
+	}
+	if (greeks && nTimeSteps >= 2)
+		*greeks = LATTICE::greeksFromNodes(v1, s1, v2, s2, v[0], currentSpot, dt);
 
-	return states[0];
+	return v[0];
 
 }
 
 void CRRBinomialTreePricer::ModelSetup(double S0, double sigma, double rate, double dt)
 {
-	double b = std::exp((2 * rate + sigma * sigma) * dt) + 1;
-	u = (b + std::sqrt(b * b - 4 * std::exp(2 * rate * dt))) / 2 /
-		std::exp(rate * dt);
-	p = (std::exp(rate * dt) - 1 / u) / (u - 1 / u);
+	LATTICE::CRR::setup(sigma, rate, dt, u, d, p);
 	currentSpot = S0;
 }
 
 void JRRNBinomialTreePricer::ModelSetup(double S0, double sigma, double rate, double dt)
 {
-	u = std::exp((rate - sigma * sigma / 2) * dt + sigma * std::sqrt(dt));
-	d = std::exp((rate - sigma * sigma / 2) * dt - sigma * std::sqrt(dt));
-	p = (std::exp(rate * dt) - d) / (u - d);
+	LATTICE::JRRN::setup(sigma, rate, dt, u, d, p);
 	currentSpot = S0;
 }
+
+vector<double> BatchTreePricer::Price(const Market& mkt, const vector<shared_ptr<Trade>>& trades)
+{
+	vector<double> pv(trades.size());
+	lattices = 0;
+
+	// vanilla options by lattice, exact types only (a call spread has its own payoff)
+	using LatticeKey = tuple<double, double, double, double>;
+	map<LatticeKey, vector<size_t>> groups;
+	for (size_t i = 0; i < trades.size(); ++i) {
+		const Trade& trade = *trades[i];
+		const auto& type = typeid(trade);
+		bool vanilla = false;
+		if (type == typeid(EuropeanOption)) {
+			auto t = static_cast<const EuropeanOption&>(trade).getOptionType();
+			vanilla = t == Call || t == Put;
+		}
+		else if (type == typeid(AmericanOption)) {
+			auto t = static_cast<const AmericanOption&>(trade).getOptionType();
+			vanilla = t == Call || t == Put;
+		}
+		if (!vanilla) {
+			pv[i] = single.Price(mkt, trades[i]);
+			if (trade.getType() == "TreeProduct")
+				++lattices;
+			continue;
+		}
+		auto in = static_cast<const TreeProduct&>(trade).treeInputs(mkt);
+		groups[LatticeKey(in.spot, in.T, in.vol, in.rate)].push_back(i);
+	}
+
+	vector<LATTICE::VanillaLane> lanes;
+	vector<double> unit;
+	spots.resize(nTimeSteps + 1);
+	for (const auto& group : groups) {
+		lanes.clear();
+		for (size_t i : group.second) {
+			const Trade& trade = *trades[i];
+			if (typeid(trade) == typeid(EuropeanOption)) {
+				const auto& opt = static_cast<const EuropeanOption&>(trade);
+				lanes.push_back({ opt.getOptionType(), opt.getStrike(), false });
+			}
+			else {
+				const auto& opt = static_cast<const AmericanOption&>(trade);
+				lanes.push_back({ opt.getOptionType(), opt.getStrike(), true });
+			}
+		}
+
+		LATTICE::Inputs in{ get<1>(group.first), get<0>(group.first), get<2>(group.first), get<3>(group.first) };
+		states.resize(size_t(nTimeSteps + 1) * lanes.size());
+		unit.resize(lanes.size());
+		LATTICE::runBatch<LATTICE::CRR>(in, nTimeSteps, lanes.data(), lanes.size(), states.data(), spots.data(), unit.data());
+		++lattices;
+
+		for (size_t l = 0; l < lanes.size(); ++l) {
+			const Trade& trade = *trades[group.second[l]];
+			pv[group.second[l]] = unit[l] * (trade.getDirection() == "long" ? trade.getNotional() : -trade.getNotional());
+		}
+	}
+	return pv;
+}
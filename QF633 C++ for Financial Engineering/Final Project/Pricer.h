@@ -7,11 +7,12 @@
 #include "Trade.h"
 #include "TreeProduct.h"
 #include "Market.h"
+#include "TreeKernel.h"
 
 // pricer interface
 class Pricer {
 public:
-	virtual double Price(const Market& mkt, shared_ptr<Trade> trade);
+	virtual double Price(const Market& mkt, const shared_ptr<Trade>& trade);
 
 private:
 	virtual double PriceTree(const Market& mkt, const TreeProduct& trade) { return 0; };
@@ -23,17 +24,32 @@ public:
 	BinomialTreePricer(int N) {
 		nTimeSteps = N;
 		states.resize(N + 1);
+		spots.resize(N + 1);
 	}
 	double PriceTree(const Market& mkt, const TreeProduct& trade) override;
 
+	// pv plus delta, gamma and theta read off the same tree, notional and direction applied
+	// as in Price
+	double PriceWithGreeks(const Market& mkt, const TreeProduct& trade, LATTICE::Greeks& greeks);
+
 protected:
+	double PriceTree(const Market& mkt, const TreeProduct& trade, LATTICE::Greeks* greeks);
+
+	// model of the templated lattice, the products that have an instantiation are priced there
+	virtual LATTICE::Model LatticeModel() const { return LATTICE::Model::Basic; }
+	// sets u, d, p and the spot for the node by node lattice below
 	virtual void ModelSetup(double S0, double sigma, double rate, double dt);
-	virtual double GetSpot(int ti, int si) const { return currentSpot* std::pow(u, ti - si)* std::pow(d, si); };
-	virtual inline double GetProbUp() const { return p; };
-	virtual double GetProbDown() const { return 1 - p; };;
+	inline double GetProbUp() const { return p; };
+	inline double GetProbDown() const { return 1 - p; };
+
+	// spots of time step ti into s[0..ti], s[si] = S0 * u^(ti - si) * d^si
+	inline void SpotLadder(int ti, double* s) const {
+		LATTICE::spotLadder(currentSpot, u, d, ti, s);
+	}
 
 	int nTimeSteps;
 	std::vector<double> states;
+	std::vector<double> spots;
 	double u; // up multiplicative
 	double d; // down
 	double p; // probability for up state
@@ -46,12 +62,8 @@ public:
 	CRRBinomialTreePricer(int N) : BinomialTreePricer(N) {}
 
 protected:
+	LATTICE::Model LatticeModel() const override { return LATTICE::Model::CRR; }
 	void ModelSetup(double S0, double sigma, double rate, double dt) override;
-	double GetSpot(int ti, int si) const override {
-		return currentSpot * std::pow(u, ti - 2 * si);
-	}
-	// double GetProbUp() const { return p; }
-	// double GetProbDown() const { return 1 - p; }
 };
 
 class JRRNBinomialTreePricer : public BinomialTreePricer
@@ -60,15 +72,64 @@ public:
 	JRRNBinomialTreePricer(int N) : BinomialTreePricer(N) {}
 
 protected:
-	void ModelSetup(double S0, double sigma, double rate, double dt);
+	LATTICE::Model LatticeModel() const override { return LATTICE::Model::JRRN; }
+	void ModelSetup(double S0, double sigma, double rate, double dt) override;
+};
 
-	//double GetSpot(int ti, int si) const
-	//{
-	//	return currentSpot * std::pow(u, ti - si) * std::pow(d, si);
-	//}
-	// double GetProbUp() const { return p; }
-	// double GetProbDown() const { return 1 - p; }
+// The pricers below converge smoothly in N instead of oscillating like CRR, so far fewer steps
+// reach the same accuracy. Products without a lattice instantiation fall back to CRR steps.
 
+// Leisen-Reimer tree, N is rounded up to odd so the strike sits on the middle node at expiry
+class LeisenReimerTreePricer : public CRRBinomialTreePricer
+{
+public:
+	LeisenReimerTreePricer(int N) : CRRBinomialTreePricer(N % 2 == 0 ? N + 1 : N) {}
+
+protected:
+	LATTICE::Model LatticeModel() const override { return LATTICE::Model::LeisenReimer; }
+};
+
+// binomial Black-Scholes (closed form over the last step) on N and N / 2 (rounded down) steps,
+// with Richardson extrapolation weighted by the two step counts
+class BBSRTreePricer : public CRRBinomialTreePricer
+{
+public:
+	BBSRTreePricer(int N) : CRRBinomialTreePricer(N) {}
+
+protected:
+	LATTICE::Model LatticeModel() const override { return LATTICE::Model::BBSR; }
+};
+
+// american options as CRR american tree - CRR european tree + Black, europeans at Black
+class ControlVariateTreePricer : public CRRBinomialTreePricer
+{
+public:
+	ControlVariateTreePricer(int N) : CRRBinomialTreePricer(N) {}
+
+protected:
+	LATTICE::Model LatticeModel() const override { return LATTICE::Model::ControlVariate; }
+};
+
+// Prices a whole book, vanilla european and american options that share spot, expiry, vol
+// and rate (on one underlying, different strikes) are priced together on one CRR lattice,
+// one lane per trade. Everything else goes through CRRBinomialTreePricer one by one.
+class BatchTreePricer
+{
+public:
+	BatchTreePricer(int N) : nTimeSteps(N), single(N) {}
+
+	// pv per trade, notional and direction applied as in Pricer::Price
+	vector<double> Price(const Market& mkt, const vector<shared_ptr<Trade>>& trades);
+
+	// lattices built by the last Price call
+	inline size_t getLattices() const { return lattices; }
+
+private:
+	int nTimeSteps;
+	CRRBinomialTreePricer single;
+	std::vector<double> states;
+	std::vector<double> spots;
+	size_t lattices = 0;
 };
 
 #endif
@@ -0,0 +1,132 @@
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+
+#include "ResultCache.h"
+#include "MappedFile.h"
+
+using namespace RESULTFILE;
+
+ResultCache::ResultCache(const string& _filename, const Market& mkt) : filename(_filename), asOf(mkt.asOf)
+{
+	// each market object is hashed once, trades only combine the ones they use
+	for (const auto& name : mkt.getCurveNames()) {
+		HASH::Hasher h;
+		mkt.getCurve(mkt.getCurveHandle(name)).hashContent(h);
+		curveHashes[name] = h.value();
+	}
+	for (const auto& name : mkt.getVolNames()) {
+		HASH::Hasher h;
+		mkt.getVolCurve(mkt.getVolHandle(name)).hashContent(h);
+		volHashes[name] = h.value();
+	}
+	for (const auto& name : mkt.getRegistry()->stocks.getNames()) {
+		HASH::Hasher h;
+		h.add(mkt.getstockPrice(mkt.getStockHandle(name)));
+		spotHashes[name] = h.value();
+	}
+	load();
+}
+
+void ResultCache::load()
+{
+	if (!std::filesystem::exists(filename))
+		return;
+	try {
+		MappedFile file(filename);
+		Header header;
+		if (file.size() < sizeof(Header))
+			return;
+		memcpy(&header, file.data(), sizeof(Header));
+		if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.endianTag != ENDIAN_TAG
+			|| header.pricingVersion != PRICING_VERSION)
+			return;
+		if (header.count > (file.size() - sizeof(Header)) / sizeof(Entry))
+			return;
+
+		previous.reserve(header.count);
+		for (uint64_t i = 0; i < header.count; ++i) {
+			Entry e;
+			memcpy(&e, file.data() + sizeof(Header) + i * sizeof(Entry), sizeof(Entry));
+			previous.emplace(Key{ e.terms, e.market, e.measure }, e.value);
+		}
+	}
+	catch (const std::runtime_error&) {
+		// unreadable cache, everything gets priced
+		previous.clear();
+	}
+}
+
+uint64_t ResultCache::marketHash(const Trade& trade) const
+{
+	HASH::Hasher h;
+	h.add(asOf);
+	// names the market does not have (a swap's "Swap" underlying, no vol) add nothing
+	auto addDependency = [&](const unordered_map<string, uint64_t>& hashes, const string& name) {
+		auto it = hashes.find(name);
+		h.add(it == hashes.end() ? uint64_t(0) : it->second);
+	};
+	addDependency(curveHashes, trade.getCurvename());
+	addDependency(volHashes, trade.getVolname());
+	addDependency(spotHashes, trade.getUnderlying());
+	return h.value();
+}
+
+ResultCache::Key ResultCache::makeKey(const Trade& trade, const string& measure) const
+{
+	HASH::Hasher m;
+	m.add(measure);
+	return Key{ trade.termsHash(), marketHash(trade), m.value() };
+}
+
+bool ResultCache::find(const Trade& trade, const string& measure, double& value)
+{
+	Key key = makeKey(trade, measure);
+	lock_guard<mutex> guard(lock);
+	auto it = previous.find(key);
+	if (it == previous.end()) {
+		++misses;
+		return false;
+	}
+	value = it->second;
+	current[key] = value;
+	++hits;
+	return true;
+}
+
+void ResultCache::store(const Trade& trade, const string& measure, double value)
+{
+	Key key = makeKey(trade, measure);
+	lock_guard<mutex> guard(lock);
+	current[key] = value;
+}
+
+void ResultCache::save() const
+{
+	lock_guard<mutex> guard(lock);
+
+	Header header = {};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.endianTag = ENDIAN_TAG;
+	header.pricingVersion = PRICING_VERSION;
+	header.count = current.size();
+
+	vector<Entry> entries;
+	entries.reserve(current.size());
+	for (const auto& kv : current)
+		entries.push_back(Entry{ kv.first.terms, kv.first.market, kv.first.measure, kv.second });
+
+	string tmpName = filename + ".tmp";
+	{
+		ofstream out(tmpName, ios::binary | ios::trunc);
+		if (!out)
+			throw std::runtime_error("Error opening file " + tmpName);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+		if (!out)
+			throw std::runtime_error("Error writing file " + tmpName);
+	}
+	std::filesystem::rename(tmpName, filename);
+}
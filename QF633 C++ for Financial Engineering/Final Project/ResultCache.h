@@ -0,0 +1,100 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+
+#include "Trade.h"
+#include "Market.h"
+
+using namespace std;
+
+// On-disk layout, little endian: Header then Entry[count]. Bump VERSION when either changes.
+namespace RESULTFILE
+{
+	constexpr char MAGIC[8] = { 'Q', 'F', 'R', 'E', 'S', 'U', 'L', 'T' };
+	constexpr uint32_t VERSION = 2;
+	constexpr uint32_t ENDIAN_TAG = 0x01020304;
+	// the pricing code the results came from. bump it with any change that moves a price or a
+	// risk number (models, payoffs, schedules, day counts, curve interpolation), a file written
+	// by another pricing version is dropped as a whole
+	constexpr uint32_t PRICING_VERSION = 1;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t endianTag;
+		uint32_t pricingVersion;
+		uint32_t reserved;
+		uint64_t count;
+	};
+
+	struct Entry {
+		uint64_t terms;
+		uint64_t market;
+		uint64_t measure;
+		double value;
+	};
+
+	static_assert(sizeof(Header) % 8 == 0 && sizeof(Entry) % 8 == 0, "result file records must stay 8 byte aligned");
+}
+
+// Results carried over between runs. An entry is keyed by the trade's terms hash, a hash of
+// the market objects the trade prices off (as-of date, its curve, vol curve and spot) and the
+// measure ("pv", "dv01", ... with the model and bump settings in it). A trade whose terms
+// and market inputs did not change since the last run is a hit and needs no pricing.
+//
+// save() keeps only the entries this run looked up or stored, results of cancelled trades
+// and old markets drop out. A missing or unreadable file, or one written by another
+// RESULTFILE::PRICING_VERSION, is an empty cache. Thread safe.
+class ResultCache
+{
+public:
+	ResultCache(const string& filename, const Market& mkt);
+
+	bool find(const Trade& trade, const string& measure, double& value);
+	void store(const Trade& trade, const string& measure, double value);
+
+	// written next to the file and renamed over it
+	void save() const;
+
+	// market side of the key
+	uint64_t marketHash(const Trade& trade) const;
+
+	inline size_t getHits() const { return hits; }
+	inline size_t getMisses() const { return misses; }
+
+private:
+	struct Key {
+		uint64_t terms;
+		uint64_t market;
+		uint64_t measure;
+
+		inline bool operator==(const Key& other) const {
+			return terms == other.terms && market == other.market && measure == other.measure;
+		}
+	};
+	struct KeyHash {
+		inline size_t operator()(const Key& k) const noexcept { return size_t(k.terms ^ (k.market * 31) ^ (k.measure * 131)); }
+	};
+
+	Key makeKey(const Trade& trade, const string& measure) const;
+	void load();
+
+	string filename;
+	Date asOf;
+	unordered_map<string, uint64_t> curveHashes;
+	unordered_map<string, uint64_t> volHashes;
+	unordered_map<string, uint64_t> spotHashes;
+
+	mutable mutex lock;
+	unordered_map<Key, double, KeyHash> previous; // from the file
+	unordered_map<Key, double, KeyHash> current;  // used in this run
+	size_t hits = 0;
+	size_t misses = 0;
+};
+
+#endif
@@ -1,7 +1,34 @@
+#include <algorithm>
+#include <cmath>
 #include "RiskEngine.h"
 #include "TreeProduct.h"
 #include "Pricer.h"
 
+namespace
+{
+	double price(const Market& mkt, const shared_ptr<Trade>& trade)
+	{
+		if (trade->getType() == "TreeProduct") {
+			CRRBinomialTreePricer treePricer(50);
+			return treePricer.Price(mkt, trade);
+		}
+		return trade->Pv(mkt);
+	}
+
+	// spot delta, read off one pricing tree for tree products, a one sided spot bump for the rest.
+	// a trade past expiry has no tree to read and is bumped as well
+	double spotDelta(const Market& mkt, const Market& shocked, double shock, const shared_ptr<Trade>& trade)
+	{
+		if (auto treePtr = dynamic_cast<const TreeProduct*>(trade.get())) {
+			CRRBinomialTreePricer treePricer(50);
+			LATTICE::Greeks greeks;
+			treePricer.PriceWithGreeks(mkt, *treePtr, greeks);
+			if (std::isfinite(greeks.delta))
+				return greeks.delta;
+		}
+		return (price(shocked, trade) - price(mkt, trade)) / shock;
+	}
+}
 
 void RiskEngine::computeRisk(string riskType, std::shared_ptr<Trade> trade, bool singleThread)
 {
@@ -10,8 +37,10 @@ void RiskEngine::computeRisk(string riskType, std::shared_ptr<Trade> trade, bool
 		if (riskType == "dv01") {
 			for (auto& kv : curveShocks) {
 				string market_id = kv.first;
-				auto mkt_u = kv.second.getMarketUp();
-				auto mkt_d = kv.second.getMarketDown();
+				if (market_id != trade->getCurvename())
+					continue; // the trade does not read this curve
+				const auto& mkt_u = kv.second.getMarketUp();
+				const auto& mkt_d = kv.second.getMarketDown();
 				double pv_up;
 				double pv_down;
 
@@ -32,8 +61,10 @@ void RiskEngine::computeRisk(string riskType, std::shared_ptr<Trade> trade, bool
 		if (riskType == "vega") {
 			for (auto& kv : volShocks) {
 				string market_id = kv.first;
-				auto mkt = kv.second.getOriginMarket();
-				auto mkt_s = kv.second.getMarket();
+				if (market_id != trade->getVolname())
+					continue;
+				const auto& mkt = kv.second.getOriginMarket();
+				const auto& mkt_s = kv.second.getMarket();
 
 				double pv;
 				double pv_up;
@@ -57,25 +88,26 @@ void RiskEngine::computeRisk(string riskType, std::shared_ptr<Trade> trade, bool
 		if (riskType == "price") {
 			for (auto& kv : priceShocks) {
 				string market_id = kv.first;
-				auto mkt = kv.second.getOriginMarket();
-				auto mkt_s = kv.second.getMarket();
-				double pv;
-				double pv_up;
-
-				if (trade->getType() == "TreeProduct") {
-					auto treePricer = make_shared<CRRBinomialTreePricer>(50);
-					pv = treePricer->Price(mkt, trade);
-					pv_up = treePricer->Price(mkt_s, trade);
-				}
-				else {
-					pv = trade->Pv(mkt);
-					pv_up = trade->Pv(mkt_s);
-				}
-				double delta = (pv_up - pv) / 2.0;
+				if (market_id != trade->getUnderlying())
+					continue;
+				double delta = spotDelta(kv.second.getOriginMarket(), kv.second.getMarket(), priceShockSize, trade);
 				result.emplace(market_id, delta);
 			}
 		}
 
+		if (riskType == "greeks") {
+			// delta, gamma and theta from the nodes of the pricing tree, no bumped markets
+			auto treePtr = dynamic_cast<TreeProduct*>(trade.get());
+			if (treePtr) {
+				CRRBinomialTreePricer treePricer(50);
+				LATTICE::Greeks greeks;
+				treePricer.PriceWithGreeks(baseMarket, *treePtr, greeks);
+				result.emplace("delta", greeks.delta);
+				result.emplace("gamma", greeks.gamma);
+				result.emplace("theta", greeks.theta);
+			}
+		}
+
 		}
 	else {
 		// Not implemented
@@ -90,8 +122,8 @@ void RiskEngine::computeRisk(string riskType, std::shared_ptr<Trade> trade, bool
 		// calling the above function asynchronously and storing the result in future object
 		for (auto& shock : curveShocks) {
 			string market_id = shock.first;
-			auto mkt_u = shock.second.getMarketUp();
-			auto mkt_d = shock.second.getMarketDown();
+			const auto& mkt_u = shock.second.getMarketUp();
+			const auto& mkt_d = shock.second.getMarketDown();
 			_futures.push_back(std::async(std::launch::async, pv_task, trade, market_id, mkt_u, mkt_u));
 		}
 
@@ -101,4 +133,103 @@ void RiskEngine::computeRisk(string riskType, std::shared_ptr<Trade> trade, bool
 		}
 
 	}
-}
\ No newline at end of file
+}
+
+vector<map<string, double>> RiskEngine::computeRisk(const string& riskType, const vector<shared_ptr<Trade>>& trades, const DependencyIndex& deps) const
+{
+	vector<map<string, double>> results(trades.size());
+	if (riskType == "dv01") {
+		for (const auto& kv : curveShocks) {
+			for (size_t t : deps.curveDependents(kv.first)) {
+				double pv_up = price(kv.second.getMarketUp(), trades[t]);
+				double pv_down = price(kv.second.getMarketDown(), trades[t]);
+				results[t].emplace(kv.first, (pv_up - pv_down) / 2.0);
+			}
+		}
+	}
+	if (riskType == "vega") {
+		for (const auto& kv : volShocks) {
+			for (size_t t : deps.volDependents(kv.first)) {
+				double pv = price(kv.second.getOriginMarket(), trades[t]);
+				double pv_up = price(kv.second.getMarket(), trades[t]);
+				results[t].emplace(kv.first, pv_up - pv);
+			}
+		}
+	}
+	if (riskType == "price") {
+		for (const auto& kv : priceShocks) {
+			for (size_t t : deps.priceDependents(kv.first))
+				results[t].emplace(kv.first, spotDelta(kv.second.getOriginMarket(), kv.second.getMarket(), priceShockSize, trades[t]));
+		}
+	}
+	return results;
+}
+
+vector<KeyRateLadder> RiskEngine::computeKeyRateRisk(const Market& market, const vector<shared_ptr<Trade>>& trades, ThreadPool& pool) const
+{
+	// one up/down market pair per (curve, pillar) bucket
+	struct Bucket {
+		string curve;
+		size_t pillar;
+		pair<double, double> support;
+		shared_ptr<CurveDecorator> shocked;
+	};
+	vector<Bucket> buckets;
+	for (const auto& name : market.getCurveNames()) {
+		auto curve = market.getCurve(name);
+		for (size_t i = 0; i < curve->getPillarDates().size(); ++i) {
+			MarketShock keyRateShock;
+			keyRateShock.market_id = name;
+			keyRateShock.shock = make_pair(curve->getPillarDates()[i], curveShockSize);
+			buckets.push_back({ name, i, curve->getBumpSupport(i), make_shared<CurveDecorator>(market, keyRateShock) });
+		}
+	}
+
+	// collect the (trade, bucket) pairs that can move before dispatching any of them
+	vector<KeyRateLadder> ladders(trades.size());
+	vector<pair<size_t, size_t>> grid;
+	for (size_t t = 0; t < trades.size(); ++t) {
+		string curvename = trades[t]->getCurvename();
+		if (curvename.empty())
+			continue;
+		auto curve = market.getCurve(curvename);
+		ladders[t].curve = curvename;
+		ladders[t].pillars = curve->getPillarDates();
+		ladders[t].dv01.assign(ladders[t].pillars.size(), 0.0);
+
+		vector<double> times;
+		for (const auto& dt : trades[t]->getRiskDates()) {
+			times.push_back(yearFraction(curve->getAnchor(), dt));
+		}
+		for (size_t b = 0; b < buckets.size(); ++b) {
+			if (buckets[b].curve != curvename)
+				continue;
+			bool affected = std::any_of(times.begin(), times.end(), [&](double x) {
+				return x > buckets[b].support.first && x < buckets[b].support.second;
+				});
+			if (affected)
+				grid.emplace_back(t, b);
+		}
+	}
+
+	mutex doneMutex;
+	condition_variable done;
+	size_t remaining = grid.size();
+	for (const auto& cell : grid) {
+		pool.enqueue([&, cell] {
+			const Bucket& bucket = buckets[cell.second];
+			CRRBinomialTreePricer pricer(50);
+			double pv_up = pricer.Price(bucket.shocked->getMarketUp(), trades[cell.first]);
+			double pv_down = pricer.Price(bucket.shocked->getMarketDown(), trades[cell.first]);
+			ladders[cell.first].dv01[bucket.pillar] = (pv_up - pv_down) / 2.0;
+
+			lock_guard<mutex> lock(doneMutex);
+			if (--remaining == 0)
+				done.notify_all();
+			});
+	}
+
+	unique_lock<mutex> lock(doneMutex);
+	done.wait(lock, [&] { return remaining == 0; });
+	return ladders;
+}
@@ -7,6 +7,8 @@
 
 #include "Trade.h"
 #include "Market.h"
+#include "threadpool.h"
+#include "DependencyIndex.h"
 
 using namespace std;
 
@@ -15,22 +17,25 @@ struct MarketShock {
 	pair<Date, double> shock; //tenor and value
 };
 
+// bucketed dv01 of one trade, one entry per pillar of its curve
+struct KeyRateLadder {
+	string curve;
+	vector<Date> pillars;
+	vector<double> dv01;
+};
+
+// The decorators hold shocked snapshots of the market. Each one shares every curve and
+// price table with the original except the single object it bumps.
 class CurveDecorator : public Market {
 public:
-	CurveDecorator(const Market& mkt, const MarketShock& curveShock) : thisMarketUp(mkt), thisMarketDown(mkt)
+	CurveDecorator(const Market& mkt, const MarketShock& curveShock)
+		: thisMarketUp(mkt.withShockedCurve(curveShock.market_id, curveShock.shock.first, curveShock.shock.second)),
+		thisMarketDown(mkt.withShockedCurve(curveShock.market_id, curveShock.shock.first, -1 * curveShock.shock.second))
 	{
 		//cout << "curve decorator is created" << endl;
-		auto curve_up = thisMarketUp.getCurve(curveShock.market_id);
-		curve_up->shock(curveShock.shock.first, curveShock.shock.second);
-		//cout << "curve tenor " << curveShock.shock.first << "is shocked" << curveShock.shock.second << endl;
-
-		auto curve_down = thisMarketDown.getCurve(curveShock.market_id);
-		curve_down->shock(curveShock.shock.first, -1 * curveShock.shock.second);
-		//cout << "curve tenor " << curveShock.shock.first << "is shocked" << curveShock.shock.second << endl;
-
 	}
-	inline const Market getMarketUp() const { return thisMarketUp; }
-	inline const Market getMarketDown() const { return thisMarketDown; }
+	inline const Market& getMarketUp() const { return thisMarketUp; }
+	inline const Market& getMarketDown() const { return thisMarketDown; }
 
 private:
 	Market thisMarketUp;
@@ -39,12 +44,10 @@ private:
 
 class VolDecorator : public Market {
 public:
-	VolDecorator(const Market& mkt, const MarketShock& volShock) : originMarket(mkt), thisMarket(mkt)
+	VolDecorator(const Market& mkt, const MarketShock& volShock)
+		: originMarket(mkt), thisMarket(mkt.withShockedVolCurve(volShock.market_id, volShock.shock.first, volShock.shock.second))
 	{
 		//cout << "vol decorator is created" << endl;
-		auto curve = thisMarket.getVolCurve(volShock.market_id);
-		curve->shock(volShock.shock.first, volShock.shock.second);
-		//cout << "vol curve " << volShock.shock.first << "is shocked" << volShock.shock.second << endl;
 	}
 
 	inline const Market& getOriginMarket() const { return originMarket; }
@@ -57,10 +60,10 @@ private:
 
 class PriceDecorator : public Market {
 public:
-	PriceDecorator(const Market& mkt, const MarketShock& priceShock) : originMarket(mkt), thisMarket(mkt)
+	PriceDecorator(const Market& mkt, const MarketShock& priceShock)
+		: originMarket(mkt), thisMarket(mkt.withShockedPrice(priceShock.market_id, priceShock.shock.second))
 	{
 		//cout << "stock price decorator is created" << endl;
-		thisMarket.shockPrice(priceShock.market_id, priceShock.shock.second);
 	}
 
 	inline const Market& getOriginMarket() const { return originMarket; }
@@ -75,37 +78,48 @@ class RiskEngine
 {
 public:
 
-	RiskEngine(const Market& market, double curve_shock, double vol_shock, double price_shock) {
+	RiskEngine(const Market& market, double curve_shock, double vol_shock, double price_shock)
+		: baseMarket(market), curveShockSize(curve_shock), priceShockSize(price_shock) {
 		//add implementation, create curve shocks, vol shocks w.r.t to curve structure etc
 		//cout << " risk engine is created .. " << endl;
 
-		auto usdCurveShock = MarketShock();
-		usdCurveShock.market_id = "USD-SOFR";
-		usdCurveShock.shock = make_pair(Date(), curve_shock);
-		auto usdShockUpCurve = CurveDecorator(market, usdCurveShock);
-		curveShocks.emplace("USD-SOFR", usdShockUpCurve);
-
-		auto sgdCurveShock = MarketShock();
-		sgdCurveShock.market_id = "SGD-SORA";
-		sgdCurveShock.shock = make_pair(Date(), curve_shock);
-		auto sgdShockUpCurve = CurveDecorator(market, sgdCurveShock);
-		curveShocks.emplace("SGD-SORA", sgdShockUpCurve);
-
-		auto VolShock= MarketShock();
-		VolShock.market_id = "LOGVOL";
-		VolShock.shock = make_pair(Date(), vol_shock);
-		auto shockedVol = VolDecorator(market, VolShock);
-		volShocks.emplace("LOGVOL", shockedVol);
-
-		auto PriceShock = MarketShock();
-		PriceShock.market_id = "PRICE";
-		PriceShock.shock = make_pair(Date(), price_shock);
-		auto shockedPrice = PriceDecorator(market, PriceShock);
-		priceShocks.emplace("PRICE", shockedPrice);
+		// one shock per curve, vol and underlying in the market, keyed like the trades' references
+		for (const auto& curve : market.getCurveNames()) {
+			auto CurveShock = MarketShock();
+			CurveShock.market_id = curve;
+			CurveShock.shock = make_pair(Date(), curve_shock);
+			curveShocks.emplace(curve, CurveDecorator(market, CurveShock));
+		}
+
+		for (const auto& vol : market.getVolNames()) {
+			auto VolShock = MarketShock();
+			VolShock.market_id = vol;
+			VolShock.shock = make_pair(Date(), vol_shock);
+			volShocks.emplace(vol, VolDecorator(market, VolShock));
+		}
+
+		for (const auto& underlying : market.getRegistry()->stocks.getNames()) {
+			auto PriceShock = MarketShock();
+			PriceShock.market_id = underlying;
+			PriceShock.shock = make_pair(Date(), price_shock);
+			priceShocks.emplace(underlying, PriceDecorator(market, PriceShock));
+		}
 	};
 
+	// only the shocks on factors the trade reads are applied, the rest are left out of the result.
+	// "price" delta of a tree product and "greeks" (delta, gamma and theta) come off one tree on
+	// the unshocked market, only the other trades are bumped
 	void computeRisk(string riskType, std::shared_ptr<Trade> trade, bool singleThread);
 
+	// whole book, each shock reprices only the dependents of its factor. one map per trade, in
+	// the order the index was built, holding an entry per factor the trade depends on.
+	vector<map<string, double>> computeRisk(const string& riskType, const vector<shared_ptr<Trade>>& trades, const DependencyIndex& deps) const;
+
+	// key rate dv01 ladder for every trade, bumping each pillar of each curve separately.
+	// The (trade x bucket) grid runs on the pool and only trades with a risk date inside
+	// the bumped part of the curve are repriced, the rest of the ladder is zero.
+	vector<KeyRateLadder> computeKeyRateRisk(const Market& market, const vector<shared_ptr<Trade>>& trades, ThreadPool& pool) const;
+
 	inline map<string, double> getResult() const {
 		return result;
 	};
@@ -115,7 +129,10 @@ private:
 	unordered_map<string, VolDecorator> volShocks;
 	unordered_map<string, PriceDecorator> priceShocks;
 
+	Market baseMarket;
 	map<string, double> result;
+	double curveShockSize;
+	double priceShockSize;
 
 };
 
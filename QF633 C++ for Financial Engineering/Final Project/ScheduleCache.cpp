@@ -0,0 +1,81 @@
+#include <mutex>
+#include <stdexcept>
+
+#include "ScheduleCache.h"
+
+const shared_ptr<const Schedule>& Schedule::empty()
+{
+	static const shared_ptr<const Schedule> none = make_shared<const Schedule>();
+	return none;
+}
+
+ScheduleCache& ScheduleCache::global()
+{
+	static ScheduleCache cache;
+	return cache;
+}
+
+size_t ScheduleCache::KeyHash::operator()(const Key& k) const noexcept
+{
+	size_t h = hash<int32_t>()(k.start);
+	for (int32_t v : { k.end, k.months, k.valueDate })
+		h = h * 1000003 ^ hash<int32_t>()(v);
+	return h;
+}
+
+shared_ptr<const Schedule> ScheduleCache::generate(const Date& start, const Date& end, int months, const Date& valueDate)
+{
+	auto schedule = make_shared<Schedule>();
+	schedule->valueDate = valueDate;
+	Date interim = start;
+	while (end - interim >= 0) {
+		if (interim - valueDate >= 0) {
+			schedule->dates.push_back(interim);
+		}
+		interim = interim.addMonths(months);
+	}
+
+	const auto& dates = schedule->dates;
+	schedule->accruals.resize(dates.size(), 0.0);
+	schedule->times.resize(dates.size());
+	for (size_t i = 0; i < dates.size(); ++i) {
+		if (i > 0)
+			schedule->accruals[i] = (dates[i] - dates[i - 1]) / 360;
+		schedule->times[i] = yearFraction(valueDate, dates[i]);
+	}
+	return schedule;
+}
+
+shared_ptr<const Schedule> ScheduleCache::get(const Date& start, const Date& end, double frequency, const Date& valueDate)
+{
+	if (start - end >= 0 || frequency <= 0 || frequency > 1)
+		throw std::runtime_error("Error: start date is later than end date, or invalid frequency!");
+	int months = int(12.0 * frequency);
+	if (months < 1)
+		throw std::runtime_error("Error: frequency shorter than a month!");
+
+	Key key{ start.serialDay(), end.serialDay(), months, valueDate.serialDay() };
+	{
+		shared_lock<shared_mutex> read(lock);
+		auto it = schedules.find(key);
+		if (it != schedules.end())
+			return it->second;
+	}
+
+	// generated outside the lock, a thread that lost the race takes the one already stored
+	auto schedule = generate(start, end, months, valueDate);
+	unique_lock<shared_mutex> write(lock);
+	return schedules.try_emplace(key, std::move(schedule)).first->second;
+}
+
+size_t ScheduleCache::size() const
+{
+	shared_lock<shared_mutex> read(lock);
+	return schedules.size();
+}
+
+void ScheduleCache::clear()
+{
+	unique_lock<shared_mutex> write(lock);
+	schedules.clear();
+}
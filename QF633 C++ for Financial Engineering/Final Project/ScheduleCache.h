@@ -0,0 +1,59 @@
+#ifndef SCHEDULE_CACHE_H
+#define SCHEDULE_CACHE_H
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <shared_mutex>
+
+#include "Date.h"
+
+using namespace std;
+
+// dates rolled from start by a fixed number of months up to end, the ones before valueDate
+// left out
+struct Schedule {
+	vector<Date> dates;
+	vector<double> accruals; // ACT/360 from the previous date, accruals[0] is 0
+	vector<double> times;    // ACT/365F from valueDate, the payment times when a curve is anchored there
+	Date valueDate;
+
+	// shared by every trade that has no schedule yet
+	static const shared_ptr<const Schedule>& empty();
+};
+
+// Process wide table of schedules. Trades with the same (start, end, months, valueDate) get
+// the same immutable Schedule, it is generated once. Safe to call from the loader threads.
+class ScheduleCache
+{
+public:
+	static ScheduleCache& global();
+
+	// same roll and checks as the swap and bond schedules, frequency in years
+	shared_ptr<const Schedule> get(const Date& start, const Date& end, double frequency, const Date& valueDate);
+
+	size_t size() const;
+	void clear();
+
+private:
+	struct Key {
+		int32_t start;
+		int32_t end;
+		int32_t months;
+		int32_t valueDate;
+
+		inline bool operator==(const Key& other) const {
+			return start == other.start && end == other.end && months == other.months && valueDate == other.valueDate;
+		}
+	};
+	struct KeyHash {
+		size_t operator()(const Key& k) const noexcept;
+	};
+
+	static shared_ptr<const Schedule> generate(const Date& start, const Date& end, int months, const Date& valueDate);
+
+	mutable shared_mutex lock;
+	unordered_map<Key, shared_ptr<const Schedule>, KeyHash> schedules;
+};
+
+#endif
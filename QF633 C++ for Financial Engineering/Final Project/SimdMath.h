@@ -0,0 +1,101 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER)))
+#include <immintrin.h>
+#endif
+
+// vectorised elementwise math for the batch pricing paths.
+// AVX-512 or AVX2+FMA is picked at compile time (/arch:AVX2, -mavx2 -mfma, ...), otherwise
+// everything falls back to the scalar std:: functions.
+namespace SIMD
+{
+	// exp(x) = 2^n * exp(r), n = round(x / ln2), |r| <= ln2 / 2, exp(r) by a degree 13 Taylor
+	// polynomial which is accurate to about 1 ulp on that range. the polynomial runs on x clamped
+	// to [-708, 709], the lanes outside are then set to 0 below and +inf above, and NaN stays
+	// NaN, as std::exp (which only differs by the denormals below -708 and the last 0.78 above 709).
+	namespace detail
+	{
+		constexpr double LOG2E = 1.4426950408889634074;
+		constexpr double LN2_HI = 6.93147180369123816490e-01;
+		constexpr double LN2_LO = 1.90821492927058770002e-10;
+		constexpr double EXP_MIN = -708.0;
+		constexpr double EXP_MAX = 709.0;
+		// 2^52, added to an integral double to expose it in the low mantissa bits
+		constexpr double SHIFTER = 4503599627370496.0;
+		constexpr double C[14] = {
+			1.0, 1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040,
+			1.0 / 40320, 1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800, 1.0 / 479001600, 1.0 / 6227020800
+		};
+	}
+
+#if defined(__AVX512F__)
+	inline __m512d exp8(__m512d x)
+	{
+		using namespace detail;
+		__m512d x0 = x;
+		x = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(EXP_MIN)), _mm512_set1_pd(EXP_MAX));
+		__m512d n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(LN2_HI), x);
+		r = _mm512_fnmadd_pd(n, _mm512_set1_pd(LN2_LO), r);
+
+		__m512d p = _mm512_set1_pd(C[13]);
+		for (int k = 12; k >= 0; --k)
+			p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(C[k]));
+
+		__m512i bits = _mm512_castpd_si512(_mm512_add_pd(_mm512_add_pd(n, _mm512_set1_pd(1023.0)), _mm512_set1_pd(SHIFTER)));
+		__m512d scale = _mm512_castsi512_pd(_mm512_slli_epi64(bits, 52));
+		__m512d y = _mm512_mul_pd(p, scale);
+
+		y = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x0, _mm512_set1_pd(EXP_MIN), _CMP_LT_OQ), y, _mm512_setzero_pd());
+		y = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x0, _mm512_set1_pd(EXP_MAX), _CMP_GT_OQ), y, _mm512_set1_pd(HUGE_VAL));
+		return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x0, x0, _CMP_UNORD_Q), y, x0);
+	}
+#endif
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+	inline __m256d exp4(__m256d x)
+	{
+		using namespace detail;
+		__m256d x0 = x;
+		x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(EXP_MIN)), _mm256_set1_pd(EXP_MAX));
+		__m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(LN2_HI), x);
+		r = _mm256_fnmadd_pd(n, _mm256_set1_pd(LN2_LO), r);
+
+		__m256d p = _mm256_set1_pd(C[13]);
+		for (int k = 12; k >= 0; --k)
+			p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(C[k]));
+
+		__m256i bits = _mm256_castpd_si256(_mm256_add_pd(_mm256_add_pd(n, _mm256_set1_pd(1023.0)), _mm256_set1_pd(SHIFTER)));
+		__m256d scale = _mm256_castsi256_pd(_mm256_slli_epi64(bits, 52));
+		__m256d y = _mm256_mul_pd(p, scale);
+
+		y = _mm256_blendv_pd(y, _mm256_setzero_pd(), _mm256_cmp_pd(x0, _mm256_set1_pd(EXP_MIN), _CMP_LT_OQ));
+		y = _mm256_blendv_pd(y, _mm256_set1_pd(HUGE_VAL), _mm256_cmp_pd(x0, _mm256_set1_pd(EXP_MAX), _CMP_GT_OQ));
+		return _mm256_blendv_pd(y, x0, _mm256_cmp_pd(x0, x0, _CMP_UNORD_Q));
+	}
+#endif
+
+	// out[i] = exp(x[i]), in place is allowed
+	inline void exp(const double* x, double* out, size_t n)
+	{
+		size_t i = 0;
+#if defined(__AVX512F__)
+		for (; i + 8 <= n; i += 8)
+			_mm512_storeu_pd(out + i, exp8(_mm512_loadu_pd(x + i)));
+#endif
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+		for (; i + 4 <= n; i += 4)
+			_mm256_storeu_pd(out + i, exp4(_mm256_loadu_pd(x + i)));
+#endif
+		for (; i < n; ++i)
+			out[i] = std::exp(x[i]);
+	}
+}
+
+#endif
@@ -6,18 +6,59 @@ double Swap::Payoff(double s) const
 	return (s - tradeRate) * swapNotional;
 }
 
-double Swap::getAnnuity(const Market& mkt) const
+const CashflowPlan& Swap::schedulePlan(const RateCurve& rc, const Date& valueDate, CashflowPlan& scratch) const
 {
-	double annuity = 0;
-	Date valueDate = mkt.asOf;
-	auto rc = mkt.getCurve(curvename);
-	for (size_t i = 1; i < cashflowDates.size(); i++) {
-		auto dt = cashflowDates[i];
+	if (plan.matches(rc.getAnchor(), valueDate))
+		return plan;
+
+	// times[0] is the end date, times[i + 1] pays fixed period taus[i]
+	scratch.anchor = rc.getAnchor();
+	scratch.valueDate = valueDate;
+	scratch.times.clear();
+	scratch.taus.clear();
+	const auto& dates = schedule->dates;
+	// the schedule's own times hold when the curve is anchored on its value date
+	bool cachedTimes = schedule->valueDate == rc.getAnchor();
+	scratch.times.reserve(dates.size());
+	scratch.times.push_back(yearFraction(rc.getAnchor(), endDate));
+	for (size_t i = 1; i < dates.size(); i++) {
+		auto dt = dates[i];
 		if (dt - valueDate < 0)
 			continue;
-		double tau = (cashflowDates[i] - cashflowDates[i - 1]) / 360;
-		double df = rc->getDf(dt, valueDate);
-		annuity += swapNotional * tau * df;
+		scratch.taus.push_back(schedule->accruals[i]);
+		scratch.times.push_back(cachedTimes ? schedule->times[i] : yearFraction(rc.getAnchor(), dt));
+	}
+	scratch.ready = true;
+	return scratch;
+}
+
+void Swap::compile(const Market& mkt)
+{
+	resolveHandles(mkt);
+	plan.ready = false;
+	if (!curveHandle.valid())
+		return; // priced by name, without a plan
+	CashflowPlan built;
+	plan = schedulePlan(discountCurve(mkt), mkt.asOf, built);
+}
+
+void Swap::discountSchedule(const RateCurve& rc, const Date& valueDate, vector<double>& taus, vector<double>& dfs) const
+{
+	// dfs[0] is the end date discount factor, dfs[i + 1] belongs to fixed period taus[i]
+	CashflowPlan scratch;
+	const CashflowPlan& p = schedulePlan(rc, valueDate, scratch);
+	taus = p.taus;
+	dfs.resize(p.times.size());
+	rc.getDf(p.times.data(), dfs.data(), p.times.size());
+}
+
+double Swap::getAnnuity(const Market& mkt) const
+{
+	double annuity = 0;
+	vector<double> taus, dfs;
+	discountSchedule(discountCurve(mkt), mkt.asOf, taus, dfs);
+	for (size_t i = 0; i < taus.size(); i++) {
+		annuity += swapNotional * taus[i] * dfs[i + 1];
 	}
 
 	return annuity;
@@ -26,17 +67,16 @@ double Swap::getAnnuity(const Market& mkt) const
 double Swap::Pv(const Market& mkt) const
 {
 	//using cash flow discunting
-	Date valueDate = mkt.asOf;
-	auto rc = mkt.getCurve(curvename);
-	double fltPv = (-swapNotional + swapNotional * rc->getDf(endDate, valueDate));
+	const RateCurve& rc = discountCurve(mkt);
+	CashflowPlan scratch;
+	const CashflowPlan& p = schedulePlan(rc, mkt.asOf, scratch);
+	vector<double> dfs(p.times.size());
+	rc.getDf(p.times.data(), dfs.data(), p.times.size());
+
+	double fltPv = (-swapNotional + swapNotional * dfs[0]);
 	double fixPv = 0;
-	for (size_t i = 1; i < cashflowDates.size(); i++) {
-		Date dt = cashflowDates[i];
-		if (dt - valueDate < 0)
-			continue;
-		double tau = (cashflowDates[i] - cashflowDates[i - 1]) / 360;
-		double df = rc->getDf(dt, valueDate);
-		fixPv += swapNotional * tau * tradeRate * df;
+	for (size_t i = 0; i < p.taus.size(); i++) {
+		fixPv += swapNotional * p.taus[i] * tradeRate * dfs[i + 1];
 	}
 
 	return direction == "pay" ? -(fixPv + fltPv) : fixPv + fltPv;
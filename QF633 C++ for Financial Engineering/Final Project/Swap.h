@@ -1,10 +1,11 @@
 #pragma once
 #include "Trade.h"
+#include "ScheduleCache.h"
 
 class Swap : public Trade {
 public:
 	Swap(const string& trade_id, const Date& tradeDate, Date start, Date end, double notional, double rate, double freq)
-		: Trade(trade_id, "SwapTrade", "Swap_" + to_string(rate) + "_" + to_string(end.year) + "-" + to_string(end.month) + "-" + to_string(end.day), tradeDate)
+		: Trade(trade_id, "SwapTrade", "Swap_" + to_string(rate) + "_" + to_string(end.getYear()) + "-" + to_string(end.getMonth()) + "-" + to_string(end.getDay()), tradeDate)
 	{
 		startDate = start;
 		endDate = end;
@@ -43,9 +44,9 @@ public:
 	inline void updateSwapName() {
 		tradeName = direction + 
 			"_Swap_" + to_string(tradeRate) + "_" +
-			to_string(endDate.year) + "-" +
-			to_string(endDate.month) + "-" +
-			to_string(endDate.day);
+			to_string(endDate.getYear()) + "-" +
+			to_string(endDate.getMonth()) + "-" +
+			to_string(endDate.getDay());
 	}
 	inline void updateBaseTradeName() {
 		updateTradeName(tradeName);
@@ -57,30 +58,42 @@ public:
 	inline string getVolname() const override { return ""; }
 	inline double getNotional() const override { return swapNotional; }
 	inline string getDirection() const override { return direction; }
+	inline double getRate() const { return tradeRate; }
+	inline const Date& getValueDate() const { return valuedate; }
+	inline const Date& getEndDate() const { return endDate; }
+	inline const vector<Date>& getCashflowDates() const { return schedule->dates; }
+	inline const shared_ptr<const Schedule>& getSchedule() const { return schedule; }
+	inline vector<Date> getRiskDates() const override {
+		vector<Date> dates(schedule->dates);
+		dates.push_back(endDate);
+		return dates;
+	}
 
 
 	// pricers
 	double Payoff(double r) const;
 	double Pv(const Market& mkt) const;
 	double getAnnuity(const Market& mkt) const;
+	void compile(const Market& mkt) override;
+	inline void hashTerms(HASH::Hasher& h) const override {
+		Trade::hashTerms(h);
+		h.add(tradeRate);
+		h.add(frequency);
+		h.add(startDate);
+		h.add(valuedate);
+	}
 
 	inline double tenor() const { return endDate - startDate; }
 
+	// shared with every trade on the same (start, end, frequency, value date)
 	void inline generateSwapSchedule() {
-		if (startDate - endDate >= 0 || frequency <= 0 || frequency > 1)
-			throw std::runtime_error("Error: start date is later than end date, or invalid frequency!");
-
-		Date interim = startDate;
-		while (endDate - interim >= 0) {
-			if (interim - valuedate >= 0) {
-				cashflowDates.push_back(interim);
-			}
-			interim = interim.addMonths(12.0 * frequency);
-		}
-
+		schedule = ScheduleCache::global().get(startDate, endDate, frequency, valuedate);
 	}
 
 private:
+	const CashflowPlan& schedulePlan(const RateCurve& rc, const Date& valueDate, CashflowPlan& scratch) const;
+	void discountSchedule(const RateCurve& rc, const Date& valueDate, vector<double>& taus, vector<double>& dfs) const;
+
 	Date valuedate;
 	Date startDate;
 	Date endDate;
@@ -89,6 +102,7 @@ private:
 	double tradeRate;
 	double frequency;
 	string tradeName;
-	vector<Date> cashflowDates;
+	shared_ptr<const Schedule> schedule = Schedule::empty();
 	string direction;
+	CashflowPlan plan;
 };
\ No newline at end of file
@@ -1,10 +1,25 @@
 #pragma once
 #include<string>
+#include <typeinfo>
 #include "Date.h"
 #include "Market.h"
+#include "Hash.h"
 
 using namespace std;
 
+// payment times (and accruals) of a fixed schedule, worked out against one curve anchor
+struct CashflowPlan {
+	Date anchor;
+	Date valueDate;
+	vector<double> taus;
+	vector<double> times;
+	bool ready = false;
+
+	inline bool matches(const Date& _anchor, const Date& _valueDate) const {
+		return ready && anchor == _anchor && valueDate == _valueDate;
+	}
+};
+
 class Trade {
 public:
 	Trade() {};
@@ -23,22 +38,71 @@ public:
 	}
 
 	// getter
-	inline string getType() { return tradeType; };
-	inline string getTradeid() { return trade_id; };
-	inline string getTradeName() { return trade_name; };
+	inline string getType() const { return tradeType; };
+	inline string getTradeid() const { return trade_id; };
+	inline string getTradeName() const { return trade_name; };
 	virtual string getUnderlying() const = 0;
 	virtual double getNotional() const = 0;
 	virtual string getDirection() const = 0;
 	virtual string getCurvename() const = 0;
 	virtual string getVolname() const = 0;
+	virtual vector<Date> getRiskDates() const = 0; // dates the trade reads its curve at
 	virtual double Pv(const Market& mkt) const = 0;
 	virtual double Payoff(double marketPrice) const = 0;
 	virtual ~Trade() {};
 
+	// looks the market names up once, after the curve/vol names are set. the handles stay
+	// valid for every snapshot derived from mkt, names the market does not know are left
+	// unresolved and go through the name lookup when priced.
+	inline void resolveHandles(const Market& mkt) {
+		curveHandle = mkt.getCurveHandle(getCurvename());
+		volHandle = mkt.getVolHandle(getVolname());
+		spotHandle = mkt.getStockHandle(getUnderlying());
+	}
+
+	// pricing plan: handles plus whatever does not move with market levels (accruals, payment
+	// and expiry times), so a reprice under a bump only does the market dependent arithmetic.
+	// call once the trade is set up, before it is shared between threads. a market whose
+	// curves have another anchor than mkt is still priced correctly, just without the plan.
+	virtual void compile(const Market& mkt) { resolveHandles(mkt); }
+
+	// content hash of the trade terms, the same terms give the same hash in every run
+	inline uint64_t termsHash() const {
+		HASH::Hasher h;
+		hashTerms(h);
+		return h.value();
+	}
+	// products add the terms the common getters do not show, after calling this
+	virtual void hashTerms(HASH::Hasher& h) const {
+		h.add(typeid(*this).name());
+		h.add(trade_id);
+		h.add(getUnderlying());
+		h.add(getNotional());
+		h.add(getDirection());
+		h.add(getCurvename());
+		h.add(getVolname());
+		h.add(getRiskDates());
+	}
+
+	// market data for pricing, by handle when resolved
+	inline const RateCurve& discountCurve(const Market& mkt) const {
+		return curveHandle.valid() ? mkt.getCurve(curveHandle) : *mkt.getCurve(getCurvename());
+	}
+	inline const VolCurve& volCurve(const Market& mkt) const {
+		return volHandle.valid() ? mkt.getVolCurve(volHandle) : *mkt.getVolCurve(getVolname());
+	}
+	inline double spot(const Market& mkt) const {
+		return spotHandle.valid() ? mkt.getstockPrice(spotHandle) : mkt.getstockPrice(getUnderlying());
+	}
+
 protected:
 	string trade_id;
 	string tradeType;
 	string trade_name;
 	string underlying = "";
 	Date tradeDate;
+
+	CurveHandle curveHandle;
+	VolHandle volHandle;
+	PriceHandle spotHandle;
 };
\ No newline at end of file
@@ -0,0 +1,352 @@
+#include <cstring>
+#include <charconv>
+#include <future>
+#include <algorithm>
+#include <stdexcept>
+
+#include "TradeLoader.h"
+#include "BinaryTradeFile.h"
+#include "TradeFactory.h"
+#include "ScheduleCache.h"
+
+namespace
+{
+	const size_t N_FIELDS = 12;
+	const size_t MIN_CHUNK = 1 << 16; // bytes, smaller files are not worth splitting
+
+	struct ChunkResult {
+		vector<TradeRecord> records;
+		vector<string> errors;
+	};
+
+	inline bool parseInt(const char* s, size_t n, int& value)
+	{
+		auto res = std::from_chars(s, s + n, value);
+		return res.ec == std::errc() && res.ptr == s + n;
+	}
+
+	inline bool parseNumber(string_view s, double& value)
+	{
+		auto res = std::from_chars(s.data(), s.data() + s.size(), value);
+		return res.ec == std::errc() && res.ptr == s.data() + s.size();
+	}
+
+	bool parseLine(string_view line, TradeRecord& rec)
+	{
+		string_view f[N_FIELDS];
+		size_t n = 0;
+		for (;;) {
+			if (n == N_FIELDS)
+				return false;
+			size_t pos = line.find(';');
+			f[n++] = line.substr(0, pos);
+			if (pos == string_view::npos)
+				break;
+			line.remove_prefix(pos + 1);
+		}
+		if (n != N_FIELDS)
+			return false;
+
+		rec.id = f[0];
+		rec.type = f[1];
+		rec.instrument = f[6];
+		rec.option = f[10];
+		rec.direction = f[11];
+		return parseIsoDate(f[2], rec.tradeDate) && parseIsoDate(f[3], rec.startDate) && parseIsoDate(f[4], rec.endDate)
+			&& parseNumber(f[5], rec.notional) && parseNumber(f[7], rec.rate)
+			&& parseNumber(f[8], rec.strike) && parseNumber(f[9], rec.freq);
+	}
+
+	ChunkResult parseChunk(const char* begin, const char* end)
+	{
+		ChunkResult result;
+
+		// count the lines first so the records are allocated once
+		size_t nLines = 1;
+		for (const char* p = begin; (p = static_cast<const char*>(memchr(p, '\n', end - p))) != nullptr; ++p)
+			++nLines;
+		result.records.reserve(nLines);
+
+		while (begin < end) {
+			const char* eol = static_cast<const char*>(memchr(begin, '\n', end - begin));
+			if (eol == nullptr)
+				eol = end;
+			string_view line(begin, eol - begin);
+			begin = eol < end ? eol + 1 : end;
+
+			if (!line.empty() && line.back() == '\r')
+				line.remove_suffix(1);
+			if (line.empty())
+				continue;
+
+			TradeRecord rec;
+			if (parseLine(line, rec))
+				result.records.push_back(rec);
+			else
+				result.errors.push_back("Error: malformed trade line '" + string(line) + "'");
+		}
+		return result;
+	}
+
+	inline string upper(string_view s)
+	{
+		string out(s);
+		transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return toupper(c); });
+		return out;
+	}
+
+	void makeTrades(const TradeRecord& rec, const Date& today, LinearTradeFactory& lFactory, OptionTradeFactory& oFactory, vector<shared_ptr<Trade>>& out)
+	{
+		string trade_id(rec.id);
+		string instr(rec.instrument);
+		string direction(rec.direction);
+
+		if (rec.type == "bond") {
+			auto bond = lFactory.createTrade(trade_id, "bond", rec.tradeDate, rec.startDate, rec.endDate);
+			auto bond_ptr = dynamic_pointer_cast<Bond>(bond);
+
+			bond_ptr->setValueDate(today);
+			bond_ptr->setCoupon(rec.rate);
+			bond_ptr->setFrequency(rec.freq);
+			bond_ptr->setNotional(rec.notional);
+			bond_ptr->settradePrice(100);
+			bond_ptr->setUnderlying(upper(instr));
+			bond_ptr->setdirection(direction);
+			bond_ptr->updateBondName();
+			bond_ptr->updateBaseTradeName();
+			bond_ptr->generateBondSchedule();
+
+			out.push_back(bond);
+		}
+		else if (rec.type == "swap") {
+			auto swap = lFactory.createTrade(trade_id, "swap", rec.tradeDate, rec.startDate, rec.endDate);
+			auto swap_ptr = dynamic_pointer_cast<Swap>(swap);
+
+			swap_ptr->setValueDate(today);
+			swap_ptr->setFrequency(rec.freq);
+			swap_ptr->setNotional(rec.notional);
+			swap_ptr->setCurvename(upper(instr));
+			swap_ptr->setRate(rec.rate);
+			swap_ptr->setdirection(direction);
+			swap_ptr->updateSwapName();
+			swap_ptr->updateBaseTradeName();
+			swap_ptr->generateSwapSchedule();
+
+			out.push_back(swap);
+		}
+		else if (rec.type == "european") {
+			auto eoption = oFactory.createTrade(trade_id, "european", rec.tradeDate, rec.startDate, rec.endDate);
+			auto eOpt = dynamic_pointer_cast<EuropeanOption>(eoption);
+
+			auto blackeoption = oFactory.createTrade(trade_id + "_Black_price", "black", rec.tradeDate, rec.startDate, rec.endDate);
+			auto blackeOpt = dynamic_pointer_cast<Black>(blackeoption);
+
+			eOpt->setNotional(rec.notional);
+			eOpt->setStrike(rec.strike);
+			eOpt->setUnderlying(instr);
+			eOpt->setdirection(direction);
+			eOpt->setCurvename("USD-SOFR"); // assume all use USD rate curve
+			eOpt->setVolname("LOGVOL");
+
+			blackeOpt->setToday(today);
+			blackeOpt->setNotional(rec.notional);
+			blackeOpt->setStrike(rec.strike);
+			blackeOpt->setUnderlying(instr);
+			blackeOpt->setdirection(direction);
+			blackeOpt->setCurvename("USD-SOFR");
+			blackeOpt->setVolname("LOGVOL");
+
+			if (rec.option == "call") {
+				eOpt->setOptionType(Call);
+				blackeOpt->setisCall(1);
+			}
+			else if (rec.option == "put") {
+				eOpt->setOptionType(Put);
+				blackeOpt->setisCall(0);
+			};
+
+			eOpt->updateOptionName();
+			eOpt->updateTreeProductTradeName();
+			blackeOpt->updateBlackName();
+			blackeOpt->updateBaseTradeName();
+
+			out.push_back(eoption);
+			out.push_back(blackeoption);
+		}
+		else if (rec.type == "american") {
+			auto amoption = oFactory.createTrade(trade_id, "american", rec.tradeDate, rec.startDate, rec.endDate);
+			auto amOpt = dynamic_pointer_cast<AmericanOption>(amoption);
+
+			amOpt->setNotional(rec.notional);
+			amOpt->setStrike(rec.strike);
+			amOpt->setUnderlying(instr);
+			amOpt->setdirection(direction);
+			amOpt->setCurvename("USD-SOFR"); // assume all use USD rate curve
+			amOpt->setVolname("LOGVOL");
+
+			if (rec.option == "call") {
+				amOpt->setOptionType(Call);
+			}
+			else if (rec.option == "put") {
+				amOpt->setOptionType(Put);
+			};
+
+			amOpt->updateOptionName();
+			amOpt->updateTreeProductTradeName();
+
+			out.push_back(amoption);
+		}
+	}
+}
+
+bool parseIsoDate(string_view s, Date& date)
+{
+	int y, m, d;
+	if (s.size() != 10 || s[4] != '-' || s[7] != '-')
+		return false;
+	if (!parseInt(s.data(), 4, y) || !parseInt(s.data() + 5, 2, m) || !parseInt(s.data() + 8, 2, d))
+		return false;
+	if (m < 1 || m > 12 || d < 1 || d > Date::daysInMonth(y, m))
+		return false;
+	date = Date(y, m, d);
+	return true;
+}
+
+const vector<TradeRecord>& TradeFileLoader::parse(ThreadPool& pool, size_t nChunks)
+{
+	records.clear();
+	errors.clear();
+	if (file.size() == 0)
+		return records;
+
+	// skip the header line
+	const char* last = file.data() + file.size();
+	const char* first = static_cast<const char*>(memchr(file.data(), '\n', file.size()));
+	if (first == nullptr)
+		return records;
+	++first;
+
+	size_t bytes = last - first;
+	nChunks = std::max<size_t>(1, std::min(nChunks, bytes / MIN_CHUNK + 1));
+
+	// cut points just after a line end
+	vector<const char*> cuts(nChunks + 1);
+	cuts[0] = first;
+	cuts[nChunks] = last;
+	for (size_t k = 1; k < nChunks; ++k) {
+		const char* p = std::max(first + bytes * k / nChunks, cuts[k - 1]);
+		const char* eol = static_cast<const char*>(memchr(p, '\n', last - p));
+		cuts[k] = eol ? eol + 1 : last;
+	}
+
+	vector<std::future<ChunkResult>> pending;
+	for (size_t k = 0; k < nChunks; ++k) {
+		const char* b = cuts[k];
+		const char* e = cuts[k + 1];
+		auto task = make_shared<std::packaged_task<ChunkResult()>>([b, e] { return parseChunk(b, e); });
+		pending.push_back(task->get_future());
+		pool.enqueue([task] { (*task)(); });
+	}
+
+	vector<ChunkResult> chunks;
+	size_t total = 0;
+	for (auto& f : pending) {
+		chunks.push_back(f.get());
+		total += chunks.back().records.size();
+	}
+	records.reserve(total);
+	for (auto& chunk : chunks) {
+		records.insert(records.end(), chunk.records.begin(), chunk.records.end());
+		for (auto& err : chunk.errors)
+			errors.push_back(std::move(err));
+	}
+	return records;
+}
+
+namespace
+{
+	// recordAt(i) gives line i as a TradeRecord, from the parsed text or from the mapped binary book
+	template <class RecordAt>
+	vector<shared_ptr<Trade>> buildFrom(size_t n, RecordAt recordAt, const Date& today, ThreadPool& pool)
+	{
+		// the factories hold no state, one pair serves every task
+		LinearTradeFactory lFactory;
+		OptionTradeFactory oFactory;
+
+		const size_t perTask = 4096;
+		vector<std::future<vector<shared_ptr<Trade>>>> pending;
+		for (size_t b = 0; b < n; b += perTask) {
+			size_t e = std::min(n, b + perTask);
+			auto task = make_shared<std::packaged_task<vector<shared_ptr<Trade>>()>>([&, b, e] {
+				vector<shared_ptr<Trade>> out;
+				out.reserve(e - b);
+				for (size_t i = b; i < e; ++i)
+					makeTrades(recordAt(i), today, lFactory, oFactory, out);
+				return out;
+			});
+			pending.push_back(task->get_future());
+			pool.enqueue([task] { (*task)(); });
+		}
+
+		vector<shared_ptr<Trade>> trades;
+		trades.reserve(n);
+		for (auto& f : pending) {
+			auto part = f.get();
+			trades.insert(trades.end(), part.begin(), part.end());
+		}
+		return trades;
+	}
+
+	template <class RecordAt>
+	void addFrom(size_t n, RecordAt recordAt, const Date& today, PortfolioStore& store)
+	{
+		for (size_t i = 0; i < n; ++i) {
+			const TradeRecord& rec = recordAt(i);
+			string id(rec.id);
+			bool isLong = rec.direction == "long";
+			if (rec.type == "swap" || rec.type == "bond") {
+				// the same interned schedule the swap and bond objects get
+				auto schedule = ScheduleCache::global().get(rec.startDate, rec.endDate, rec.freq, today);
+				if (rec.type == "swap")
+					store.addSwap(id, upper(rec.instrument), rec.notional, rec.rate, *schedule, rec.endDate, rec.direction == "pay");
+				else
+					store.addBond(id, Bond::curveForUnderlying(upper(rec.instrument)), rec.notional, rec.rate, rec.freq, *schedule, rec.endDate, isLong);
+			}
+			else if (rec.type == "european" || rec.type == "american") {
+				OptionType optType;
+				if (rec.option == "call")
+					optType = Call;
+				else if (rec.option == "put")
+					optType = Put;
+				else
+					throw std::runtime_error("Error: unknown option type for trade " + id);
+
+				// assume all use USD rate curve, as the trade objects do
+				if (rec.type == "european")
+					store.addEuropean(id, "USD-SOFR", "LOGVOL", string(rec.instrument), rec.notional, rec.strike, optType, rec.endDate, isLong);
+				else
+					store.addAmerican(id, "USD-SOFR", "LOGVOL", string(rec.instrument), rec.notional, rec.strike, optType, rec.endDate, isLong);
+			}
+		}
+	}
+}
+
+vector<shared_ptr<Trade>> buildTrades(const vector<TradeRecord>& records, const Date& today, ThreadPool& pool)
+{
+	return buildFrom(records.size(), [&](size_t i) -> const TradeRecord& { return records[i]; }, today, pool);
+}
+
+vector<shared_ptr<Trade>> buildTrades(const BinaryTradeFile& book, const Date& today, ThreadPool& pool)
+{
+	return buildFrom(book.size(), [&](size_t i) { return book.record(i); }, today, pool);
+}
+
+void addToStore(const vector<TradeRecord>& records, const Date& today, PortfolioStore& store)
+{
+	addFrom(records.size(), [&](size_t i) -> const TradeRecord& { return records[i]; }, today, store);
+}
+
+void addToStore(const BinaryTradeFile& book, const Date& today, PortfolioStore& store)
+{
+	addFrom(book.size(), [&](size_t i) { return book.record(i); }, today, store);
+}
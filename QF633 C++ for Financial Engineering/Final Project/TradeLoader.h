@@ -0,0 +1,69 @@
+#ifndef TRADE_LOADER_H
+#define TRADE_LOADER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+#include "Date.h"
+#include "Trade.h"
+#include "MappedFile.h"
+#include "PortfolioStore.h"
+#include "threadpool.h"
+
+using namespace std;
+
+// one line of trade.txt, the text fields point into the loaded file
+struct TradeRecord {
+	string_view id;
+	string_view type;
+	Date tradeDate;
+	Date startDate;
+	Date endDate;
+	double notional = 0;
+	string_view instrument;
+	double rate = 0;
+	double strike = 0;
+	double freq = 0;
+	string_view option;
+	string_view direction;
+};
+
+// YYYY-MM-DD, fixed positions
+bool parseIsoDate(string_view s, Date& date);
+
+// Loads trade.txt (header line, then id;type;trade_dt;start_dt;end_dt;notional;instrument;rate;strike;freq;option;direction).
+// The file is memory mapped and cut into chunks on line ends, each chunk is parsed on the pool
+// with string_views and from_chars, nothing is copied until the trades are built. Records
+// point into the mapping and live as long as the loader.
+class TradeFileLoader
+{
+public:
+	explicit TradeFileLoader(const string& filename) : file(filename) {};
+
+	// records in file order, malformed lines are left out and reported in getErrors()
+	const vector<TradeRecord>& parse(ThreadPool& pool, size_t nChunks);
+
+	inline const vector<TradeRecord>& getRecords() const { return records; }
+	inline const vector<string>& getErrors() const { return errors; }
+
+private:
+	MappedFile file;
+	vector<TradeRecord> records;
+	vector<string> errors;
+};
+
+class BinaryTradeFile;
+
+// trade objects through LinearTradeFactory / OptionTradeFactory, set up the same way
+// loadTradeFromFile did (a european also gets its black pricing twin). built in parallel, in record order.
+vector<shared_ptr<Trade>> buildTrades(const vector<TradeRecord>& records, const Date& today, ThreadPool& pool);
+// the same, read straight from the mapped records of a binary book
+vector<shared_ptr<Trade>> buildTrades(const BinaryTradeFile& book, const Date& today, ThreadPool& pool);
+
+// straight into the columnar store, no trade objects
+void addToStore(const vector<TradeRecord>& records, const Date& today, PortfolioStore& store);
+void addToStore(const BinaryTradeFile& book, const Date& today, PortfolioStore& store);
+
+#endif
@@ -0,0 +1,371 @@
+#ifndef TREE_KERNEL_H
+#define TREE_KERNEL_H
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "Types.h"
+#include "Payoff.h"
+
+// Binomial lattice with the model, payoff and exercise style as template parameters, so the
+// node update has no virtual calls and no switch on the option type. The run time choices are
+// made once per price by the dispatch helpers at the bottom.
+namespace LATTICE
+{
+	// market inputs of one tree, T in years
+	struct Inputs {
+		double T;
+		double spot;
+		double vol;
+		double rate;
+	};
+
+	// LeisenReimer and BBSR (binomial Black-Scholes with Richardson extrapolation) converge
+	// smoothly, ControlVariate is a CRR american tree corrected by the european closed form
+	enum class Model { Basic, CRR, JRRN, LeisenReimer, BBSR, ControlVariate };
+
+	// N(x), standard normal cdf
+	inline double normalCdf(double x) {
+		return 0.5 * std::erfc(-x / std::sqrt(2.0));
+	}
+
+	// european value over tau years, the Black formula for calls and puts (as Black::Pv) and
+	// the cash-or-nothing value for the binaries. the payoff itself once tau or vol is zero
+	inline double blackScholes(OptionType type, double strike, double S, double tau, double rate, double vol) {
+		double sd = vol * std::sqrt(tau);
+		if (!(sd > 0))
+			return PAYOFF::VanillaOption(type, strike, S);
+		double df = std::exp(-rate * tau);
+		double d1 = (std::log(S / strike) + (rate + 0.5 * vol * vol) * tau) / sd;
+		double d2 = d1 - sd;
+		switch (type)
+		{
+		case Call:
+			return S * normalCdf(d1) - strike * df * normalCdf(d2);
+		case Put:
+			return strike * df * normalCdf(-d2) - S * normalCdf(-d1);
+		case BinaryCall:
+			return df * normalCdf(d2);
+		case BinaryPut:
+			return df * normalCdf(-d2);
+		default:
+			throw "unsupported optionType";
+		}
+	}
+
+	// read off the nodes of steps 1 and 2 of the tree, per unit like the price. theta is per
+	// year, from the middle node of step 2. that node is only back at the spot when u * d = 1
+	// (CRR), on the other trees its spot move is taken out with delta and gamma.
+	// NaN with fewer than 2 steps.
+	struct Greeks {
+		double delta = std::numeric_limits<double>::quiet_NaN();
+		double gamma = std::numeric_limits<double>::quiet_NaN();
+		double theta = std::numeric_limits<double>::quiet_NaN();
+	};
+
+	// node values v and spots s of steps 1 (v1, s1) and 2 (v2, s2), up node first, v0 and s0 at
+	// the root
+	inline Greeks greeksFromNodes(const double* v1, const double* s1, const double* v2, const double* s2, double v0, double s0, double dt) {
+		Greeks g;
+		g.delta = (v1[0] - v1[1]) / (s1[0] - s1[1]);
+		double deltaUp = (v2[0] - v2[1]) / (s2[0] - s2[1]);
+		double deltaDown = (v2[1] - v2[2]) / (s2[1] - s2[2]);
+		g.gamma = (deltaUp - deltaDown) / ((s2[0] - s2[2]) / 2);
+		double dS = s2[1] - s0;
+		g.theta = (v2[1] - v0 - g.delta * dS - 0.5 * g.gamma * dS * dS) / (2 * dt);
+		return g;
+	}
+
+	// models, up/down factors and up probability for one step
+	struct Basic {
+		static inline void setup(double sigma, double rate, double dt, double& u, double& d, double& p) {
+			u = 1.1;
+			d = 0.9;
+			p = (std::exp(rate) - d) / (u - d);
+		}
+	};
+
+	struct CRR {
+		static inline void setup(double sigma, double rate, double dt, double& u, double& d, double& p) {
+			double b = std::exp((2 * rate + sigma * sigma) * dt) + 1;
+			u = (b + std::sqrt(b * b - 4 * std::exp(2 * rate * dt))) / 2 / std::exp(rate * dt);
+			d = 1 / u;
+			p = (std::exp(rate * dt) - d) / (u - d);
+		}
+	};
+
+	struct JRRN {
+		static inline void setup(double sigma, double rate, double dt, double& u, double& d, double& p) {
+			u = std::exp((rate - sigma * sigma / 2) * dt + sigma * std::sqrt(dt));
+			d = std::exp((rate - sigma * sigma / 2) * dt - sigma * std::sqrt(dt));
+			p = (std::exp(rate * dt) - d) / (u - d);
+		}
+	};
+
+	// Leisen-Reimer, p and u from the Peizer-Pratt inversion of d2 and d1 so the strike sits
+	// on the middle node at expiry. nSteps is expected to be odd
+	inline void leisenReimer(const Inputs& in, double strike, int nSteps, double& u, double& d, double& p) {
+		auto h = [nSteps](double z) {
+			double n = nSteps;
+			double x = z / (n + 1.0 / 3 + 0.1 / (n + 1));
+			double root = std::sqrt(0.25 - 0.25 * std::exp(-x * x * (n + 1.0 / 6)));
+			return z < 0 ? 0.5 - root : 0.5 + root;
+		};
+		double sd = in.vol * std::sqrt(in.T);
+		double d1 = (std::log(in.spot / strike) + (in.rate + 0.5 * in.vol * in.vol) * in.T) / sd;
+		double growth = std::exp(in.rate * in.T / nSteps);
+		p = h(d1 - sd);
+		u = growth * h(d1) / p;
+		d = (growth - p * u) / (1 - p);
+	}
+
+	// payoffs, the option type is fixed at compile time. closedForm is the european value over
+	// tau and centre the strike Leisen-Reimer lines the tree up with
+	template <OptionType Type>
+	struct Vanilla {
+		double strike;
+		inline double operator()(double S) const { return PAYOFF::VanillaOption(Type, strike, S); }
+		inline double closedForm(double S, double tau, double rate, double vol) const { return blackScholes(Type, strike, S, tau, rate, vol); }
+		inline double centre() const { return strike; }
+	};
+
+	struct CallSpread {
+		double strike1;
+		double strike2;
+		inline double operator()(double S) const { return PAYOFF::CallSpread(strike1, strike2, S); }
+		// a long call at strike1 and a short call at strike2, per unit of the spread width
+		inline double closedForm(double S, double tau, double rate, double vol) const {
+			return (blackScholes(Call, strike1, S, tau, rate, vol) - blackScholes(Call, strike2, S, tau, rate, vol)) / (strike2 - strike1);
+		}
+		inline double centre() const { return (strike1 + strike2) / 2; }
+	};
+
+	// exercise styles
+	struct European {
+		static constexpr bool early = false;
+	};
+
+	struct American {
+		static constexpr bool early = true;
+	};
+
+	// s[i] = S0 * u^(k - i) * d^i for i in [0, k]
+	inline void spotLadder(double S0, double u, double d, int k, double* s) {
+		s[0] = S0 * std::pow(u, k);
+		double ratio = d / u;
+		for (int i = 1; i <= k; i++)
+			s[i] = s[i - 1] * ratio;
+	}
+
+	// Backward induction on a tree with the given u, d and p, unit price. states and spots need
+	// nSteps + 1 entries. smooth replaces the last step by the closed form over dt (the BBS
+	// tree). greeks, when given, come from the same backward induction
+	template <class Payoff, class Exercise>
+	double induct(const Inputs& in, int nSteps, double u, double d, double p, bool smooth, const Payoff& payoff,
+		double* states, double* spots, Greeks* greeks) {
+		double dt = in.T / nSteps;
+		double df = std::exp(-in.rate * dt);
+		double pu = df * p;
+		double pd = df * (1 - p);
+
+		double v1[2] = {}, s1[2] = {}, v2[3] = {}, s2[3] = {};
+		auto capture = [&](int k) {
+			if (greeks && k == 2) {
+				spotLadder(in.spot, u, d, 2, s2);
+				std::copy(states, states + 3, v2);
+			}
+			if (greeks && k == 1) {
+				spotLadder(in.spot, u, d, 1, s1);
+				std::copy(states, states + 2, v1);
+			}
+		};
+
+		int last = smooth ? nSteps - 1 : nSteps;
+		spotLadder(in.spot, u, d, last, spots);
+		for (int i = 0; i <= last; i++) {
+			states[i] = smooth ? payoff.closedForm(spots[i], dt, in.rate, in.vol) : payoff(spots[i]);
+			if constexpr (Exercise::early)
+				states[i] = std::max(payoff(spots[i]), states[i]);
+		}
+		capture(last);
+
+		for (int k = last - 1; k >= 0; k--) {
+			for (int i = 0; i <= k; i++)
+				states[i] = pu * states[i] + pd * states[i + 1];
+			if constexpr (Exercise::early) {
+				spotLadder(in.spot, u, d, k, spots);
+				for (int i = 0; i <= k; i++)
+					states[i] = std::max(payoff(spots[i]), states[i]);
+			}
+			capture(k);
+		}
+		// the greeks need step 2 of the lattice, a smoothed tree of 2 steps does not have one
+		if (greeks)
+			*greeks = last >= 2 ? greeksFromNodes(v1, s1, v2, s2, states[0], in.spot, dt) : Greeks();
+		return states[0];
+	}
+
+	// unit price on the tree of model M
+	template <class M, class Payoff, class Exercise>
+	double run(const Inputs& in, int nSteps, const Payoff& payoff, double* states, double* spots, Greeks* greeks = nullptr) {
+		double u, d, p;
+		M::setup(in.vol, in.rate, in.T / nSteps, u, d, p);
+		return induct<Payoff, Exercise>(in, nSteps, u, d, p, false, payoff, states, spots, greeks);
+	}
+
+	// on an odd number of steps, one less than nSteps when that is even
+	template <class Payoff, class Exercise>
+	double runLeisenReimer(const Inputs& in, int nSteps, const Payoff& payoff, double* states, double* spots, Greeks* greeks = nullptr) {
+		int n = nSteps % 2 == 0 ? nSteps - 1 : nSteps;
+		double u, d, p;
+		leisenReimer(in, payoff.centre(), n, u, d, p);
+		return induct<Payoff, Exercise>(in, n, u, d, p, false, payoff, states, spots, greeks);
+	}
+
+	// BBS trees (CRR steps, closed form last step) of n = nSteps and m = nSteps / 2 steps. the
+	// error goes as 1 / n, so (n * P(n) - m * P(m)) / (n - m) takes it out, which is
+	// 2 * P(n) - P(n / 2) for an even n. the greeks are extrapolated the same way, unless the
+	// coarse tree is too short to have them (n < 6), then they are the fine tree's
+	template <class Payoff, class Exercise>
+	double runBBSR(const Inputs& in, int nSteps, const Payoff& payoff, double* states, double* spots, Greeks* greeks = nullptr) {
+		auto bbs = [&](int n, Greeks* g) {
+			double u, d, p;
+			CRR::setup(in.vol, in.rate, in.T / n, u, d, p);
+			return induct<Payoff, Exercise>(in, n, u, d, p, true, payoff, states, spots, g);
+		};
+		if (nSteps < 2)
+			return bbs(nSteps, greeks);
+
+		int n = nSteps;
+		int m = nSteps / 2;
+		auto extrapolate = [n, m](double fine, double coarse) { return (n * fine - m * coarse) / (n - m); };
+
+		// the smoothed coarse tree has m - 1 full steps, the greeks need 2
+		bool coarseGreeks = greeks && m >= 3;
+		Greeks half;
+		double fine = bbs(n, greeks);
+		double coarse = bbs(m, coarseGreeks ? &half : nullptr);
+		if (coarseGreeks) {
+			greeks->delta = extrapolate(greeks->delta, half.delta);
+			greeks->gamma = extrapolate(greeks->gamma, half.gamma);
+			greeks->theta = extrapolate(greeks->theta, half.theta);
+		}
+		return extrapolate(fine, coarse);
+	}
+
+	// american CRR tree minus the european CRR tree plus the european closed form, the tree
+	// error of the two largely cancels. a european is the closed form itself. the greeks are
+	// the plain CRR ones of the tree for the exercise style
+	template <class Payoff, class Exercise>
+	double runControlVariate(const Inputs& in, int nSteps, const Payoff& payoff, double* states, double* spots, Greeks* greeks = nullptr) {
+		double exact = payoff.closedForm(in.spot, in.T, in.rate, in.vol);
+		if constexpr (Exercise::early) {
+			double american = run<CRR, Payoff, Exercise>(in, nSteps, payoff, states, spots, greeks);
+			double european = run<CRR, Payoff, European>(in, nSteps, payoff, states, spots);
+			return american - european + exact;
+		}
+		else {
+			if (greeks)
+				run<CRR, Payoff, Exercise>(in, nSteps, payoff, states, spots, greeks);
+			return exact;
+		}
+	}
+
+	// one vanilla trade on a shared lattice
+	struct VanillaLane {
+		OptionType type; // Call or Put
+		double strike;
+		bool american;
+	};
+
+	// Every lane priced on the same tree, unit price of lane l into out[l]. The states are
+	// node major (node i of lane l at i * nLanes + l), so the update runs across the lanes.
+	// states needs (nSteps + 1) * nLanes entries, spots nSteps + 1.
+	template <class M>
+	void runBatch(const Inputs& in, int nSteps, const VanillaLane* lanes, size_t nLanes, double* states, double* spots, double* out) {
+		double dt = in.T / nSteps;
+		double u, d, p;
+		M::setup(in.vol, in.rate, dt, u, d, p);
+		double df = std::exp(-in.rate * dt);
+		double pu = df * p;
+		double pd = df * (1 - p);
+
+		// payoff max(phi * (S - K), 0), phi = 1 for a call and -1 for a put
+		std::vector<double> phi(nLanes), strike(nLanes), early(nLanes);
+		bool anyEarly = false;
+		for (size_t l = 0; l < nLanes; ++l) {
+			phi[l] = lanes[l].type == Put ? -1.0 : 1.0;
+			strike[l] = lanes[l].strike;
+			early[l] = lanes[l].american ? 1.0 : 0.0;
+			anyEarly = anyEarly || lanes[l].american;
+		}
+
+		spotLadder(in.spot, u, d, nSteps, spots);
+		for (int i = 0; i <= nSteps; i++) {
+			double* v = states + i * nLanes;
+			for (size_t l = 0; l < nLanes; ++l)
+				v[l] = std::max(phi[l] * (spots[i] - strike[l]), 0.0);
+		}
+
+		for (int k = nSteps - 1; k >= 0; k--) {
+			for (int i = 0; i <= k; i++) {
+				double* v = states + i * nLanes;
+				const double* next = v + nLanes;
+				for (size_t l = 0; l < nLanes; ++l)
+					v[l] = pu * v[l] + pd * next[l];
+			}
+			if (anyEarly) {
+				spotLadder(in.spot, u, d, k, spots);
+				for (int i = 0; i <= k; i++) {
+					double* v = states + i * nLanes;
+					for (size_t l = 0; l < nLanes; ++l) {
+						double exercised = std::max(std::max(phi[l] * (spots[i] - strike[l]), 0.0), v[l]);
+						v[l] = early[l] != 0.0 ? exercised : v[l];
+					}
+				}
+			}
+		}
+		for (size_t l = 0; l < nLanes; ++l)
+			out[l] = states[l];
+	}
+
+	template <class Payoff, class Exercise>
+	double price(Model model, const Inputs& in, int nSteps, const Payoff& payoff, double* states, double* spots, Greeks* greeks = nullptr) {
+		switch (model)
+		{
+		case Model::CRR:
+			return run<CRR, Payoff, Exercise>(in, nSteps, payoff, states, spots, greeks);
+		case Model::JRRN:
+			return run<JRRN, Payoff, Exercise>(in, nSteps, payoff, states, spots, greeks);
+		case Model::LeisenReimer:
+			return runLeisenReimer<Payoff, Exercise>(in, nSteps, payoff, states, spots, greeks);
+		case Model::BBSR:
+			return runBBSR<Payoff, Exercise>(in, nSteps, payoff, states, spots, greeks);
+		case Model::ControlVariate:
+			return runControlVariate<Payoff, Exercise>(in, nSteps, payoff, states, spots, greeks);
+		default:
+			return run<Basic, Payoff, Exercise>(in, nSteps, payoff, states, spots, greeks);
+		}
+	}
+
+	template <class Exercise>
+	double priceVanilla(Model model, OptionType type, double strike, const Inputs& in, int nSteps, double* states, double* spots, Greeks* greeks = nullptr) {
+		switch (type)
+		{
+		case Call:
+			return price<Vanilla<Call>, Exercise>(model, in, nSteps, Vanilla<Call>{ strike }, states, spots, greeks);
+		case Put:
+			return price<Vanilla<Put>, Exercise>(model, in, nSteps, Vanilla<Put>{ strike }, states, spots, greeks);
+		case BinaryCall:
+			return price<Vanilla<BinaryCall>, Exercise>(model, in, nSteps, Vanilla<BinaryCall>{ strike }, states, spots, greeks);
+		case BinaryPut:
+			return price<Vanilla<BinaryPut>, Exercise>(model, in, nSteps, Vanilla<BinaryPut>{ strike }, states, spots, greeks);
+		default:
+			throw "unsupported optionType";
+		}
+	}
+}
+
+#endif
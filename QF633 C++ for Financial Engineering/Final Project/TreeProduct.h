@@ -2,6 +2,7 @@
 #define _TREE_PRODUCT_H
 #include "Date.h"
 #include "Trade.h"
+#include "TreeKernel.h"
 
 // this class provide a common member function interface for option type of trade.
 class TreeProduct : public Trade
@@ -18,12 +19,57 @@ public:
 		updateTradeName(_tradename);
 	}
 
+	// market inputs of a tree, T in years from mkt.asOf
+	using TreeInputs = LATTICE::Inputs;
+
 	// getters
 	virtual const Date& GetExpiry() const = 0;
+	TreeInputs treeInputs(const Market& mkt) const;
+	vector<Date> getRiskDates() const override { return { GetExpiry() }; }
 
 	// pricers
 	virtual double ValueAtNode(double stockPrice, double t, double continuationValue) const = 0;
+	// unit price (and greeks when asked for) on the templated lattice, false for products that
+	// have no instantiation and go through Payoff / ValueAtNode node by node
+	virtual bool latticePrice(LATTICE::Model model, const TreeInputs& in, int nSteps, double* states, double* spots, double& value, LATTICE::Greeks* greeks) const { return false; }
 	double Pv(const Market& mkt) const { return 0; };
+	void compile(const Market& mkt) override;
+
+private:
+	struct Plan {
+		Date asOf;
+		Date curveAnchor;
+		Date volAnchor;
+		double T = 0;
+		double curveTime = 0;
+		double volTime = 0;
+		bool ready = false;
+	};
+	Plan plan;
 };
 
+inline void TreeProduct::compile(const Market& mkt)
+{
+	resolveHandles(mkt);
+	plan.ready = false;
+	if (!curveHandle.valid() || !volHandle.valid())
+		return;
+	plan.asOf = mkt.asOf;
+	plan.curveAnchor = mkt.getCurve(curveHandle).getAnchor();
+	plan.volAnchor = mkt.getVolCurve(volHandle).getAnchor();
+	plan.T = (GetExpiry() - mkt.asOf) / 365.0;
+	plan.curveTime = yearFraction(plan.curveAnchor, GetExpiry());
+	plan.volTime = yearFraction(plan.volAnchor, GetExpiry());
+	plan.ready = true;
+}
+
+inline TreeProduct::TreeInputs TreeProduct::treeInputs(const Market& mkt) const
+{
+	const RateCurve& rc = discountCurve(mkt);
+	const VolCurve& vc = volCurve(mkt);
+	if (plan.ready && plan.asOf == mkt.asOf && rc.getAnchor() == plan.curveAnchor && vc.getAnchor() == plan.volAnchor)
+		return { plan.T, spot(mkt), vc.getVol(plan.volTime), rc.getRate(plan.curveTime) };
+	return { (GetExpiry() - mkt.asOf) / 365.0, spot(mkt), vc.getVol(GetExpiry()), rc.getRate(GetExpiry()) };
+}
+
 #endif
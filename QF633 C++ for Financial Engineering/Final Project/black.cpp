@@ -27,12 +27,30 @@ double Black::Payoff(double marketPrice) const {
 	return direction == "long" ? payoff : -payoff;
 };
 
+void Black::compile(const Market& mkt)
+{
+	resolveHandles(mkt);
+	plan.ready = false;
+	if (!curveHandle.valid() || !volHandle.valid())
+		return;
+	plan.curveAnchor = mkt.getCurve(curveHandle).getAnchor();
+	plan.volAnchor = mkt.getVolCurve(volHandle).getAnchor();
+	plan.expiry = (expiryDate - today) / 365.0;
+	plan.curveTime = yearFraction(plan.curveAnchor, expiryDate);
+	plan.volTime = yearFraction(plan.volAnchor, expiryDate);
+	plan.ready = true;
+}
+
 double Black::Pv(const Market& mkt) const {
-	double expiry = (expiryDate - today) / 365.0;
-	double marketPrice = mkt.getstockPrice(underlying);
-	double df = mkt.getCurve(curvename)->getDf(expiryDate, today);
-	double r = mkt.getCurve(curvename)->getRate(expiryDate);
-	double vol = mkt.getVolCurve(volname)->getVol(expiryDate);
+	double marketPrice = spot(mkt);
+	const RateCurve& rc = discountCurve(mkt);
+	const VolCurve& vc = volCurve(mkt);
+	bool planned = plan.ready && rc.getAnchor() == plan.curveAnchor && vc.getAnchor() == plan.volAnchor;
+
+	double expiry = planned ? plan.expiry : (expiryDate - today) / 365.0;
+	double r = planned ? rc.getRate(plan.curveTime) : rc.getRate(expiryDate);
+	double df = exp(-r * expiry); // same as rc.getDf(expiryDate, today)
+	double vol = planned ? vc.getVol(plan.volTime) : vc.getVol(expiryDate);
 
 	// N(d1) and N(d2) are the cumulative distribution function values for a standard normal distribution
 	double d1_val = (log(marketPrice / strike) + (r + 0.5 * vol * vol) * expiry) / (vol * sqrt(expiry));
@@ -61,9 +61,9 @@ public:
 			+ to_string(strike) + "_" +
 			to_string(isCall) + "_" +
 			underlying + "_" +
-			to_string(expiryDate.year) + "-" +
-			to_string(expiryDate.month) + "-" +
-			to_string(expiryDate.day);
+			to_string(expiryDate.getYear()) + "-" +
+			to_string(expiryDate.getMonth()) + "-" +
+			to_string(expiryDate.getDay());
 	}
 	inline void updateBaseTradeName() {
 		updateTradeName(tradeName);
@@ -76,12 +76,30 @@ public:
 	inline string getVolname() const override { return volname; }
 	inline double getNotional() const override { return notional; }
 	inline string getDirection() const override { return direction; }
+	inline vector<Date> getRiskDates() const override { return { expiryDate }; }
 
 	// pricing
 	double Payoff(double marketPrice) const;
 	double Pv(const Market& mkt) const;
+	void compile(const Market& mkt) override;
+	inline void hashTerms(HASH::Hasher& h) const override {
+		Trade::hashTerms(h);
+		h.add(strike);
+		h.add(isCall);
+		h.add(today);
+	}
 
 private:
+	// expiry as a year fraction from today and from the curve anchors
+	struct Plan {
+		Date curveAnchor;
+		Date volAnchor;
+		double expiry = 0;
+		double curveTime = 0;
+		double volTime = 0;
+		bool ready = false;
+	};
+
 	string underlying;
 	double notional;
 	double strike;
@@ -94,6 +112,7 @@ private:
 	string direction;
 	Date today;
 	string tradeName;
+	Plan plan;
 };
 
 #endif
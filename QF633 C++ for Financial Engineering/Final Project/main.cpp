@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <iomanip> // for setprecision
 #include <memory>
+#include <filesystem>
+#include <typeinfo>
 
 #include "TradeFactory.h"
 #include "Market.h"
@@ -15,6 +17,15 @@
 #include "black.h"
 #include "threadpool.h"
 #include "RiskEngine.h"
+#include "Bootstrapper.h"
+#include "LiveMarket.h"
+#include "PortfolioStore.h"
+#include "TradeLoader.h"
+#include "BinaryTradeFile.h"
+#include "IncrementalPortfolio.h"
+#include "CashflowStore.h"
+#include "ScheduleCache.h"
+#include "ResultCache.h"
 
 using namespace std;
 
@@ -76,9 +87,7 @@ Date addTenorToDate(const time_t& date, const string& tenor) {
 	struct tm timeInfo;
 	if (localtime_s(&timeInfo, &date_seconds) == 0) {
 		// localtime_s() convert current system time into localtime and populate tm struct
-		future_date.year = timeInfo.tm_year + 1900; //1900 based
-		future_date.month = timeInfo.tm_mon + 1; //0 based
-		future_date.day = timeInfo.tm_mday;
+		future_date = Date(timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday); //1900 based, 0 based month
 	};
 
 	return future_date;
@@ -106,59 +115,8 @@ void loadDataFromFile(Market& mkt, const string& filename, const time_t& today)
 	}
 
 	string line;
-	// handling for rate curve
-	if (filename == "sgd_curve.txt") {
-		shared_ptr<RateCurve> curve = std::make_shared<RateCurve>();
-		string header;
-
-		if (getline(input_file, line)) {
-			header = line;
-		};
-
-		while (getline(input_file, line))
-		{
-			if (line.size() != 0) {
-				vector<string> lineOfTrade = split(line, ":");
-
-				Date future_date = addTenorToDate(today, lineOfTrade[0]);
-
-				string pct = lineOfTrade[1];
-				pct.erase(remove(pct.begin(), pct.end(), '%'), pct.end());
-				double convert_pct = stod(pct) / 100;
-
-				curve->addRate(future_date, convert_pct);
-			}
-		}
-
-		mkt.addCurve(header, curve);
-	}
-	else if (filename == "usd_curve.txt") {
-		shared_ptr<RateCurve> curve = std::make_shared<RateCurve>();
-		string header;
-
-		if (getline(input_file, line)) {
-			header = line;
-		};
-
-		while (getline(input_file, line))
-		{
-			if (line.size() != 0) {
-				vector<string> lineOfTrade = split(line, ":");
-
-				Date future_date = addTenorToDate(today, lineOfTrade[0]);
-
-				string pct = lineOfTrade[1];
-				pct.erase(remove(pct.begin(), pct.end(), '%'), pct.end());
-				double convert_pct = stod(pct) / 100;
-
-				curve->addRate(future_date, convert_pct);
-			}
-		}
-
-		mkt.addCurve(header, curve);
-	}
 	// handling for vol curve
-	else if (filename == "vol.txt") {
+	if (filename == "vol.txt") {
 		auto curve = make_shared<VolCurve>();
 		string header = "LOGVOL";
 
@@ -208,18 +166,12 @@ void loadDataFromFile(Market& mkt, const string& filename, const time_t& today)
 	}
 }
 
-void loadTradeFromFile(vector<shared_ptr<Trade>>& tradesSet, const string& filename, const Date& today)
+void loadCurveQuotesFromFile(map<string, vector<CurveQuote>>& quotes, const string& filename, const Date& today)
 {
 	/*
-	load trade data from file
-	insert into vector
+	curve files hold deposit rates up to 1Y and par swap rates from 1Y on
 	*/
-
-	// Open the file for reading
 	ifstream input_file(filename);
-	vector<string> lines;
-	auto lFactory = make_unique<LinearTradeFactory>();
-	auto oFactory = make_unique<OptionTradeFactory>();
 
 	// Check if the file was opened successfully
 	if (!input_file.is_open())
@@ -228,142 +180,27 @@ void loadTradeFromFile(vector<shared_ptr<Trade>>& tradesSet, const string& filen
 	}
 
 	string line;
-	// Read the file line by line
+	string header;
 	if (getline(input_file, line)) {
-		std::cout << "Skipped first row: " << line << endl; // Optional: Print skipped line
+		header = line;
 	};
 
+	vector<CurveQuote>& curveQuotes = quotes[header];
 	while (getline(input_file, line))
 	{
-		std::cout << "Processing line: " << line << endl;
-
 		if (line.size() != 0) {
-			vector<string> lineOfTrade = split(line, ";");
-			string trade_id = lineOfTrade[0];
-			string type = lineOfTrade[1];
-
-			Date trade_dt = Date(stoi(lineOfTrade[2].substr(0, 4)), stoi(lineOfTrade[2].substr(6, 2)), stoi(lineOfTrade[2].substr(9, 2)));
-			Date start_dt = Date(stoi(lineOfTrade[3].substr(0, 4)), stoi(lineOfTrade[3].substr(6, 2)), stoi(lineOfTrade[3].substr(9, 2)));
-			Date end_dt = Date(stoi(lineOfTrade[4].substr(0, 4)), stoi(lineOfTrade[4].substr(6, 2)), stoi(lineOfTrade[4].substr(9, 2)));
-
-			double notional = stod(lineOfTrade[5]);
-			string instr = lineOfTrade[6];
-			double rate = stod(lineOfTrade[7]);
-			double strike = stod(lineOfTrade[8]);
-			double freq = stod(lineOfTrade[9]);
-			string option = lineOfTrade[10];
-			string direction = lineOfTrade[11];
-
-
-			if (type == "bond") {
-				//convert to uppercase
-				transform(instr.begin(), instr.end(), instr.begin(), [](unsigned char c) { return toupper(c); });
-
-				auto bond = lFactory->createTrade(trade_id, "bond", trade_dt, start_dt, end_dt);
-				auto bond_ptr = dynamic_pointer_cast<Bond>(bond);
-
-				//setting bond parameters
-				bond_ptr->setValueDate(today);
-				bond_ptr->setCoupon(rate);
-				bond_ptr->setFrequency(freq);
-				bond_ptr->setNotional(notional);
-				bond_ptr->settradePrice(100);
-				bond_ptr->setUnderlying(instr);
-				bond_ptr->setdirection(direction);
-				bond_ptr->updateBondName();
-				bond_ptr->updateBaseTradeName();
-				bond_ptr->generateBondSchedule();
-
-				tradesSet.push_back(bond);
-			}
-			else if (type == "swap") {
-				//convert to uppercase
-				transform(instr.begin(), instr.end(), instr.begin(), [](unsigned char c) { return toupper(c); });
-
-				auto swap = lFactory->createTrade(trade_id, "swap", trade_dt, start_dt, end_dt);
-				auto swap_ptr = dynamic_pointer_cast<Swap>(swap);
-
-				//setting swap parameters
-				swap_ptr->setValueDate(today);
-				swap_ptr->setFrequency(freq);
-				swap_ptr->setNotional(notional);
-				swap_ptr->setCurvename(instr);
-				swap_ptr->setRate(rate);
-				swap_ptr->setdirection(direction);
-				swap_ptr->updateSwapName();
-				swap_ptr->updateBaseTradeName();
-				swap_ptr->generateSwapSchedule();
-
-				tradesSet.push_back(swap);
-			}
-			else if (type == "european") {
-				auto eoption = oFactory->createTrade(trade_id, "european", trade_dt, start_dt, end_dt);
-				auto eOpt = dynamic_pointer_cast<EuropeanOption>(eoption);
-
-				auto blackeoption = oFactory->createTrade(trade_id + "_Black_price", "black", trade_dt, start_dt, end_dt);
-				auto blackeOpt = dynamic_pointer_cast<Black>(blackeoption);
-
-				//setting european option parameters
-				eOpt->setNotional(notional);
-				eOpt->setStrike(strike);
-				eOpt->setUnderlying(instr);
-				eOpt->setdirection(direction);
-				eOpt->setCurvename("USD-SOFR"); // assume all use USD rate curve
-				eOpt->setVolname("LOGVOL");
-
-				//setting european option parameters using black scholes
-				blackeOpt->setToday(today);
-				blackeOpt->setNotional(notional);
-				blackeOpt->setStrike(strike);
-				blackeOpt->setUnderlying(instr);
-				blackeOpt->setdirection(direction);
-				blackeOpt->setCurvename("USD-SOFR"); // assume all use USD rate curve
-				blackeOpt->setVolname("LOGVOL");
-
-				if (option == "call") {
-					eOpt->setOptionType(Call);
-					blackeOpt->setisCall(1);
-				}
-				else if (option == "put") {
-					eOpt->setOptionType(Put);
-					blackeOpt->setisCall(0);
-				};
-
-				eOpt->updateOptionName();
-				eOpt->updateTreeProductTradeName();
-				blackeOpt->updateBlackName();
-				blackeOpt->updateBaseTradeName();
-
-				tradesSet.push_back(eoption);
-				tradesSet.push_back(blackeoption);
-			}
+			vector<string> lineOfQuote = split(line, ":");
 
-			else if (type == "american") {
-				auto amoption = oFactory->createTrade(trade_id, "american", trade_dt, start_dt, end_dt);
-				auto amOpt = dynamic_pointer_cast<AmericanOption>(amoption);
-
-				//setting american option parameters
-				amOpt->setNotional(notional);
-				amOpt->setStrike(strike);
-				amOpt->setUnderlying(instr);
-				amOpt->setdirection(direction);
-				amOpt->setCurvename("USD-SOFR"); // assume all use USD rate curve
-				amOpt->setVolname("LOGVOL");
-
-				if (option == "call") {
-					amOpt->setOptionType(Call);
-				}
-				else if (option == "put") {
-					amOpt->setOptionType(Put);
-				};
-
-				amOpt->updateOptionName();
-				amOpt->updateTreeProductTradeName();
-
-				tradesSet.push_back(amoption);
-			}
-		}
+			string pct = lineOfQuote[1];
+			pct.erase(remove(pct.begin(), pct.end(), '%'), pct.end());
 
+			CurveQuote quote;
+			quote.tenor = lineOfQuote[0];
+			quote.maturity = addTenor(today, quote.tenor);
+			quote.rate = stod(pct) / 100;
+			quote.type = quote.maturity < today.addYears(1) ? Deposit : ParSwap;
+			curveQuotes.push_back(quote);
+		}
 	}
 }
 
@@ -401,6 +238,41 @@ void outPutResult(vector<TradeResult>& result, const string& filename)
 }
 
 
+void outPutKeyRateRisk(const vector<shared_ptr<Trade>>& portfolio, const vector<KeyRateLadder>& ladders, const string& filename)
+{
+	ofstream outfile(filename, ios::app);
+	if (!outfile)
+	{
+		cerr << "Error opening file for writing!" << endl;
+	}
+
+	outfile
+		<< "\n" << left << "Key rate DV01 ladder per curve pillar" << "\n";
+
+	// Write separator line
+	outfile << string(140, '-') << "\n";
+
+	// one line per trade, one column per pillar of the trade's curve
+	for (size_t i = 0; i < portfolio.size(); ++i)
+	{
+		const auto& ladder = ladders[i];
+		if (ladder.pillars.empty())
+			continue;
+		outfile
+			<< left << setw(20) << portfolio[i]->getTradeid()
+			<< left << setw(12) << ladder.curve;
+		for (size_t p = 0; p < ladder.pillars.size(); ++p)
+		{
+			const Date& pillar = ladder.pillars[p];
+			string tenor = to_string(pillar.getYear()) + "-" + to_string(pillar.getMonth()) + "-" + to_string(pillar.getDay());
+			outfile << tenor << ":" << fixed << setprecision(6) << ladder.dv01[p] << " ";
+		}
+		outfile << "\n";
+	}
+
+	outfile << string(140, '-') << "\n";
+}
+
 void writeErrorTofile(vector<PricingError>& result, const string& filename)
 {
 	/*
@@ -437,37 +309,128 @@ int main()
 	struct tm timeInfo;
 	if (localtime_s(&timeInfo, &t) == 0) {
 		// localtime_s() convert current system time into localtime and populate tm struct
-		valueDate.year = timeInfo.tm_year + 1900; //1900 based
-		valueDate.month = timeInfo.tm_mon + 1; //0 based
-		valueDate.day = timeInfo.tm_mday;
+		valueDate = Date(timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday); //1900 based, 0 based month
 	};
 	std::cout << valueDate << endl;
 	auto mkt = make_shared<Market>(valueDate);
 
 
-	//loading market 
-	vector<string> filenames = { "sgd_curve.txt", "usd_curve.txt", "vol.txt", "stockPrice.txt", "bondPrice.txt" };
-	for (const auto& filename : filenames) {
-		loadDataFromFile(*mkt, filename, t);
+	// Get hardware concurrency (number of available CPU threads)
+	size_t hardwareConcurrency = thread::hardware_concurrency();
+
+	ThreadPool pool(hardwareConcurrency);
+
+	//loading market, from today's binary snapshot when there is one (restart), otherwise from
+	//the text files. the snapshot is rebuilt whenever one of the text files is newer than it.
+	string snapshotFile = "market.snapshot";
+	vector<string> curveFiles = { "sgd_curve.txt", "usd_curve.txt" };
+	vector<string> filenames = { "vol.txt", "stockPrice.txt", "bondPrice.txt" };
+	auto snapshotCurrent = [&]() {
+		if (!filesystem::exists(snapshotFile))
+			return false;
+		auto snapshotTime = filesystem::last_write_time(snapshotFile);
+		for (const auto& sources : { curveFiles, filenames }) {
+			for (const auto& filename : sources) {
+				if (filesystem::exists(filename) && snapshotTime < filesystem::last_write_time(filename))
+					return false;
+			}
+		}
+		return true;
+	};
+	auto loadStart = chrono::high_resolution_clock::now();
+	bool fromSnapshot = false;
+	if (snapshotCurrent()) {
+		try {
+			Market snapshot = Market::loadSnapshot(snapshotFile);
+			if (snapshot.asOf == valueDate) {
+				*mkt = snapshot;
+				fromSnapshot = true;
+			}
+		}
+		catch (const std::exception& e) {
+			cerr << e.what() << endl;
+		}
+	}
+
+	if (!fromSnapshot) {
+		// rate curves are bootstrapped from the quotes per currency in parallel
+		map<string, vector<CurveQuote>> curveQuotes;
+		for (const auto& filename : curveFiles) {
+			loadCurveQuotesFromFile(curveQuotes, filename, valueDate);
+		}
+		CurveBootstrapper bootstrapper(valueDate);
+		for (const auto& curve : bootstrapper.bootstrap(curveQuotes, pool)) {
+			mkt->addCurve(curve.first, curve.second);
+		}
+
+		for (const auto& filename : filenames) {
+			loadDataFromFile(*mkt, filename, t);
+		}
+		mkt->saveSnapshot(snapshotFile);
 	}
+	auto loadEnd = chrono::high_resolution_clock::now();
+	std::cout << "Market loaded from " << (fromSnapshot ? "snapshot" : "text files") << " in "
+		<< chrono::duration_cast<chrono::microseconds>(loadEnd - loadStart).count() << " microseconds" << endl;
 
 	mkt->Print();
 
-	//creating trade factory
-	vector<shared_ptr<Trade>> myPortfolio;
+	//loading trades from the binary book, which is rebuilt from trade.txt whenever the text file is newer
+	//or the book is unreadable (e.g. an older file version). without trade.txt the book is used as it is.
+	//the text is mapped and parsed in chunks on the pool, the binary book is used in place.
 	string file = "trade.txt";
-	loadTradeFromFile(myPortfolio, file, valueDate);
+	string binaryFile = "trade.bin";
+	auto tradeStart = chrono::high_resolution_clock::now();
+	auto rebuildBook = [&]() {
+		TradeFileLoader tradeLoader(file);
+		tradeLoader.parse(pool, hardwareConcurrency);
+		for (const auto& err : tradeLoader.getErrors()) {
+			cerr << err << endl;
+		}
+		BinaryTradeFile::write(tradeLoader.getRecords(), binaryFile);
+	};
+	bool haveText = filesystem::exists(file);
+	if (!filesystem::exists(binaryFile) || (haveText && filesystem::last_write_time(binaryFile) < filesystem::last_write_time(file))) {
+		rebuildBook();
+	}
+	unique_ptr<BinaryTradeFile> tradeBook;
+	try {
+		tradeBook = make_unique<BinaryTradeFile>(binaryFile);
+	}
+	catch (const std::runtime_error& e) {
+		if (!haveText)
+			throw;
+		cerr << e.what() << ", rebuilding it from " << file << endl;
+		rebuildBook();
+		tradeBook = make_unique<BinaryTradeFile>(binaryFile);
+	}
+	vector<shared_ptr<Trade>> myPortfolio = buildTrades(*tradeBook, valueDate, pool);
+	auto tradeEnd = chrono::high_resolution_clock::now();
+	std::cout << "Loaded " << tradeBook->size() << " trades in "
+		<< chrono::duration_cast<chrono::microseconds>(tradeEnd - tradeStart).count() << " microseconds, "
+		<< ScheduleCache::global().size() << " distinct schedules" << endl;
+	// compile every trade against the market once: handles, accruals and payment times
+	for (auto& trade : myPortfolio) {
+		trade->compile(*mkt);
+	}
 
 	//Pricing Portfolio
 	auto treePricer = make_shared<CRRBinomialTreePricer>(50);
 
 	//using single thread
 	vector<TradeResult> result;
-	string str_value_date = to_string(valueDate.year) + "-" + to_string(valueDate.month) + "-" + to_string(valueDate.day);
+	string str_value_date = to_string(valueDate.getYear()) + "-" + to_string(valueDate.getMonth()) + "-" + to_string(valueDate.getDay());
+
+	// results of the last run, a trade is only priced when its terms or market inputs changed
+	ResultCache resultCache("result.cache", *mkt);
+	const string pvMeasure = "pv:crr50";
 
 	auto start = chrono::high_resolution_clock::now();
 	for (size_t i = 0; i < myPortfolio.size(); ++i) {
-		double pv = treePricer->Price(*mkt, myPortfolio[i]);
+		double pv;
+		if (!resultCache.find(*myPortfolio[i], pvMeasure, pv)) {
+			pv = treePricer->Price(*mkt, myPortfolio[i]);
+			resultCache.store(*myPortfolio[i], pvMeasure, pv);
+		}
 		string id = myPortfolio[i]->getTradeid();
 		string name = myPortfolio[i]->getTradeName();
 		std::cout << id << " " << fixed << setprecision(6) << pv << endl;
@@ -482,6 +445,107 @@ int main()
 	auto duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
 	std::cout << "PV Sequential Execution Time: " << duration << " microseconds" << endl;
 
+	// same book in the columnar store straight from the trade records, one batch kernel per product table
+	PortfolioStore store(*mkt);
+	addToStore(*tradeBook, valueDate, store);
+	start = chrono::high_resolution_clock::now();
+	vector<double> storePv = store.price(*mkt, 50);
+	end = chrono::high_resolution_clock::now();
+	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	unordered_map<string, double> objectPv;
+	for (const auto& re : result) {
+		objectPv[re.id] = re.PV;
+	}
+	double maxDiff = 0;
+	for (size_t i = 0; i < storePv.size(); ++i) {
+		double pv = objectPv[store.getTradeId(i)];
+		if (!std::isnan(pv))
+			maxDiff = std::max(maxDiff, std::fabs(storePv[i] - pv));
+	}
+	std::cout << "PV Columnar Batch Execution Time: " << duration << " microseconds, "
+		<< store.size() << " trades, max diff to object pricing " << scientific << maxDiff << fixed << endl;
+
+	// options on the same underlying and expiry share one lattice, one lane per strike
+	BatchTreePricer batchPricer(50);
+	start = chrono::high_resolution_clock::now();
+	vector<double> batchPv = batchPricer.Price(*mkt, myPortfolio);
+	end = chrono::high_resolution_clock::now();
+	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	double maxBatchDiff = 0;
+	for (size_t i = 0; i < batchPv.size(); ++i) {
+		if (std::isfinite(result[i].PV))
+			maxBatchDiff = std::max(maxBatchDiff, std::abs(batchPv[i] - result[i].PV));
+	}
+	std::cout << "PV Batch Lattice Execution Time: " << duration << " microseconds, " << batchPricer.getLattices() << " lattices for "
+		<< batchPv.size() << " trades, max diff to object pricing " << scientific << maxBatchDiff << fixed << endl;
+
+	// delta, gamma and theta off the pricing tree, delta checked against a central 1% spot bump
+	CRRBinomialTreePricer greekPricer(50);
+	size_t nGreeks = 0;
+	double maxDeltaDiff = 0;
+	start = chrono::high_resolution_clock::now();
+	for (const auto& trade : myPortfolio) {
+		auto treePtr = dynamic_cast<TreeProduct*>(trade.get());
+		if (treePtr == nullptr)
+			continue;
+		LATTICE::Greeks greeks;
+		greekPricer.PriceWithGreeks(*mkt, *treePtr, greeks);
+		if (!std::isfinite(greeks.delta))
+			continue;
+		double h = 0.01 * treePtr->treeInputs(*mkt).spot;
+		double bumpDelta = (greekPricer.Price(mkt->withShockedPrice(trade->getUnderlying(), h), trade)
+			- greekPricer.Price(mkt->withShockedPrice(trade->getUnderlying(), -h), trade)) / (2 * h);
+		maxDeltaDiff = std::max(maxDeltaDiff, std::abs(greeks.delta - bumpDelta) / std::max(1.0, std::abs(bumpDelta)));
+		++nGreeks;
+	}
+	end = chrono::high_resolution_clock::now();
+	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	std::cout << "Lattice Greeks Execution Time: " << duration << " microseconds, " << nGreeks
+		<< " tree trades, max relative delta diff to spot bump " << scientific << maxDeltaDiff << fixed << endl;
+
+	// steps each tree needs, max error of the unit price. europeans against the closed form,
+	// americans against a 5000 step BBSR tree (all trees are first order on americans)
+	vector<pair<const TreeProduct*, double>> europeans;
+	vector<pair<const TreeProduct*, double>> americans;
+	BBSRTreePricer referencePricer(5000);
+	for (const auto& trade : myPortfolio) {
+		auto treePtr = dynamic_cast<TreeProduct*>(trade.get());
+		if (treePtr == nullptr)
+			continue;
+		auto in = treePtr->treeInputs(*mkt);
+		if (!(in.T > 0))
+			continue; // expired
+		if (typeid(*treePtr) == typeid(EuropeanOption)) {
+			auto eOpt = static_cast<EuropeanOption*>(treePtr);
+			double exact = LATTICE::blackScholes(eOpt->getOptionType(), eOpt->getStrike(), in.spot, in.T, in.rate, in.vol);
+			if (std::isfinite(exact))
+				europeans.emplace_back(treePtr, exact);
+		}
+		else if (typeid(*treePtr) == typeid(AmericanOption)) {
+			double reference = referencePricer.PriceTree(*mkt, *treePtr);
+			if (std::isfinite(reference))
+				americans.emplace_back(treePtr, reference);
+		}
+	}
+	auto treeError = [&](BinomialTreePricer& pricer, const vector<pair<const TreeProduct*, double>>& trades) {
+		double err = 0;
+		for (const auto& tr : trades)
+			err = std::max(err, std::abs(pricer.PriceTree(*mkt, *tr.first) - tr.second));
+		return err;
+	};
+	for (int N : { 25, 50, 100 }) {
+		CRRBinomialTreePricer crr(N);
+		LeisenReimerTreePricer lr(N);
+		BBSRTreePricer bbsr(N);
+		ControlVariateTreePricer cv(N);
+		// the control variate prices a european at the closed form, no european column for it
+		std::cout << "European tree error at " << N << " steps (" << europeans.size() << " trades), CRR " << scientific
+			<< treeError(crr, europeans) << " Leisen-Reimer " << treeError(lr, europeans) << " BBSR " << treeError(bbsr, europeans) << fixed << endl;
+		std::cout << "American tree error at " << N << " steps (" << americans.size() << " trades), CRR " << scientific
+			<< treeError(crr, americans) << " Leisen-Reimer " << treeError(lr, americans) << " BBSR " << treeError(bbsr, americans)
+			<< " control variate " << treeError(cv, americans) << fixed << endl;
+	}
+
 	//creating risk engine
 	double curve_shock = 0.0001;// 1 bp of zero rate
 	double vol_shock = 0.01; //1% of log normal vol
@@ -489,17 +553,89 @@ int main()
 	//string risk_id = "USD-SOFR:DV01:DEAL 01";
 	RiskEngine risk(*mkt, curve_shock, vol_shock, price_shock);
 
+	// each bump only reprices the trades that read the bumped curve or vol, and only the
+	// trades the result cache could not answer for
 	start = chrono::high_resolution_clock::now();
+	const string dv01Measure = "dv01:crr50:" + to_string(curve_shock);
+	const string vegaMeasure = "vega:crr50:" + to_string(vol_shock);
+	vector<shared_ptr<Trade>> dirty;
+	vector<size_t> dirtyPos;
 	for (size_t i = 0; i < myPortfolio.size(); ++i) {
-		risk.computeRisk("dv01", myPortfolio[i], true);
-		result[i].DV01 = risk.getResult()[myPortfolio[i]->getCurvename()];
-
-		risk.computeRisk("vega", myPortfolio[i], true);
-		result[i].Vega = risk.getResult()[myPortfolio[i]->getVolname()];
+		bool cached = resultCache.find(*myPortfolio[i], dv01Measure, result[i].DV01);
+		cached = resultCache.find(*myPortfolio[i], vegaMeasure, result[i].Vega) && cached;
+		if (!cached) {
+			dirty.push_back(myPortfolio[i]);
+			dirtyPos.push_back(i);
+		}
+	}
+	DependencyIndex deps(dirty);
+	auto dv01s = risk.computeRisk("dv01", dirty, deps);
+	auto vegas = risk.computeRisk("vega", dirty, deps);
+	for (size_t k = 0; k < dirty.size(); ++k) {
+		TradeResult& re = result[dirtyPos[k]];
+		re.DV01 = dv01s[k][dirty[k]->getCurvename()];
+		re.Vega = vegas[k][dirty[k]->getVolname()];
+		resultCache.store(*dirty[k], dv01Measure, re.DV01);
+		resultCache.store(*dirty[k], vegaMeasure, re.Vega);
 	}
+	resultCache.save();
 	end = chrono::high_resolution_clock::now();
 	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
 	std::cout << "Risk Sequential Execution Time: " << duration << " microseconds" << endl;
+	std::cout << "Result cache: " << resultCache.getHits() << " hits, " << resultCache.getMisses() << " misses" << endl;
+
+	// spot delta of the book, one tree per tree product, only the closed form trades bump the spot
+	start = chrono::high_resolution_clock::now();
+	DependencyIndex bookDeps(myPortfolio);
+	auto deltas = risk.computeRisk("price", myPortfolio, bookDeps);
+	end = chrono::high_resolution_clock::now();
+	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	size_t nDeltas = 0;
+	for (const auto& d : deltas)
+		nDeltas += d.size();
+	std::cout << "Spot Delta Execution Time: " << duration << " microseconds, " << nDeltas << " trade deltas" << endl;
+
+	// linear book as flat cashflows, pv and dv01 by re-discounting one curve at a time
+	CashflowStore cashflows(*mkt, myPortfolio);
+	start = chrono::high_resolution_clock::now();
+	vector<double> linearPv = cashflows.price(*mkt);
+	vector<double> linearDv01(cashflows.size(), 0.0);
+	for (const auto& name : mkt->getCurveNames()) {
+		CurveHandle h = mkt->getCurveHandle(name);
+		vector<double> up(linearPv), down(linearPv);
+		cashflows.reprice(mkt->withShockedCurve(name, Date(), curve_shock), h, up);
+		cashflows.reprice(mkt->withShockedCurve(name, Date(), -curve_shock), h, down);
+		for (size_t k = 0; k < cashflows.size(); ++k)
+			linearDv01[k] += (up[k] - down[k]) / 2.0;
+	}
+	end = chrono::high_resolution_clock::now();
+	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	double maxPvDiff = 0, maxDv01Diff = 0;
+	for (size_t k = 0; k < cashflows.size(); ++k) {
+		maxPvDiff = std::max(maxPvDiff, std::abs(linearPv[k] - result[cashflows.getSource(k)].PV));
+		maxDv01Diff = std::max(maxDv01Diff, std::abs(linearDv01[k] - result[cashflows.getSource(k)].DV01));
+	}
+	std::cout << "Linear PV and DV01 from " << cashflows.cashflows() << " flat cashflows: " << duration << " microseconds, "
+		<< cashflows.size() << " trades, max diff to object pricing " << scientific << maxPvDiff << " / " << maxDv01Diff << fixed << endl;
+
+	// book level numbers straight from the netted (curve, date) ladder
+	start = chrono::high_resolution_clock::now();
+	double bookPv = cashflows.bookPv(*mkt);
+	double bookDv01 = 0;
+	for (const auto& name : mkt->getCurveNames()) {
+		CurveHandle h = mkt->getCurveHandle(name);
+		bookDv01 += (cashflows.curvePv(mkt->withShockedCurve(name, Date(), curve_shock), h)
+			- cashflows.curvePv(mkt->withShockedCurve(name, Date(), -curve_shock), h)) / 2.0;
+	}
+	end = chrono::high_resolution_clock::now();
+	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	double sumPv = 0, sumDv01 = 0;
+	for (size_t k = 0; k < cashflows.size(); ++k) {
+		sumPv += linearPv[k];
+		sumDv01 += linearDv01[k];
+	}
+	std::cout << "Linear book PV and DV01 from " << cashflows.nodes() << " netted ladder nodes: " << duration << " microseconds, "
+		<< "diff to per trade sum " << scientific << std::abs(bookPv - sumPv) << " / " << std::abs(bookDv01 - sumDv01) << fixed << endl;
 
 
 	outPutResult(result, "result.txt");
@@ -520,11 +656,6 @@ int main()
 		multithread_result.push_back(re);
 	}
 
-	// Get hardware concurrency (number of available CPU threads)
-	size_t hardwareConcurrency = thread::hardware_concurrency();
-
-	ThreadPool pool(hardwareConcurrency);
-
 	start = chrono::high_resolution_clock::now();
 	// Enqueue tasks for execution 
 	for (size_t i = 0; i < myPortfolio.size(); ++i) {
@@ -582,6 +713,78 @@ int main()
 	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
 	std::cout << "Risk Parallel Execution Time (ThreadPool): " << duration << " microseconds" << endl;
 
+	// key rate dv01 ladder, (trade x pillar) grid on the pool
+	start = chrono::high_resolution_clock::now();
+	auto ladders = risk.computeKeyRateRisk(*mkt, myPortfolio, pool);
+	end = chrono::high_resolution_clock::now();
+	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	std::cout << "Key Rate DV01 Parallel Execution Time (ThreadPool): " << duration << " microseconds" << endl;
+
+	outPutKeyRateRisk(myPortfolio, ladders, "result.txt");
+
+	// live market, the portfolio is priced on the pool while stock price updates are published.
+	// every task prices off the snapshot it pinned, the writer never waits on the workers.
+	LiveMarket liveMkt(*mkt);
+	vector<double> livePv(myPortfolio.size());
+	start = chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < myPortfolio.size(); ++i) {
+		tasksRemaining++;
+
+		pool.enqueue([&, i] {
+			auto reader = liveMkt.pin();
+			CRRBinomialTreePricer livePricer(50);
+			livePv[i] = livePricer.Price(reader.market(), myPortfolio[i]);
+
+			tasksRemaining--;
+			cv.notify_one();
+			}
+		);
+	}
+
+	double spx = mkt->getstockPrice("SP500");
+	for (int k = 1; k <= 10; ++k) {
+		liveMkt.updateStockPrice("SP500", spx + k);
+	}
+
+	{
+		unique_lock<mutex> lock(cvMutex);
+		cv.wait(lock, [&] { return tasksRemaining == 0; });
+	}
+
+	end = chrono::high_resolution_clock::now();
+	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	std::cout << "PV Parallel Execution Time with live updates (ThreadPool): " << duration << " microseconds" << endl;
+	std::cout << "live market epoch: " << liveMkt.getEpoch() << ", snapshots awaiting reclaim: " << liveMkt.reclaim() << endl;
+
+	// intraday book, every event prices the one trade it touches and moves the totals by the difference
+	IncrementalPortfolio intraday(*mkt, curve_shock, vol_shock);
+	start = chrono::high_resolution_clock::now();
+	for (const auto& trade : myPortfolio) {
+		intraday.add(trade);
+	}
+	end = chrono::high_resolution_clock::now();
+	duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	std::cout << "Incremental book of " << intraday.size() << " trades built in " << duration << " microseconds" << endl;
+
+	auto firstSwap = find_if(myPortfolio.begin(), myPortfolio.end(), [](const shared_ptr<Trade>& t) { return dynamic_pointer_cast<Swap>(t) != nullptr; });
+	if (firstSwap != myPortfolio.end()) {
+		auto amended = make_shared<Swap>(*dynamic_pointer_cast<Swap>(*firstSwap));
+		amended->setNotional(2 * amended->getNotional());
+
+		start = chrono::high_resolution_clock::now();
+		intraday.amend(amended);
+		intraday.cancel(amended->getTradeid());
+		intraday.add(*firstSwap);
+		end = chrono::high_resolution_clock::now();
+		duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+		std::cout << "Amend, cancel and rebook of trade " << amended->getTradeid() << " in " << duration << " microseconds" << endl;
+	}
+	std::cout << "Book PV " << intraday.getPv() << " (" << intraday.getUnpriced() << " trades unpriced)" << endl;
+	for (const auto& kv : intraday.getDv01())
+		std::cout << "  DV01 " << kv.first << " " << kv.second << endl;
+	for (const auto& kv : intraday.getVega())
+		std::cout << "  Vega " << kv.first << " " << kv.second << endl;
+
 	std::cout << "Project build successfully!" << endl;
 	std::cout << "Thanks PROF! This is my last module for MQF, thank you for the semester" << endl;
 	return 0;